@@ -12,6 +12,7 @@
 #include "qhttpserverrequest_p.h"
 
 #include <QtCore/qloggingcategory.h>
+#include <QtCore/qscopeguard.h>
 #include <QtNetwork/qtcpserver.h>
 #include <QtNetwork/qtcpsocket.h>
 #if QT_CONFIG(localserver)
@@ -21,6 +22,7 @@
 
 #if QT_CONFIG(ssl)
 #include <QtNetwork/qsslserver.h>
+#include <QtNetwork/qsslsocket.h>
 #endif
 
 #if QT_CONFIG(http) && QT_CONFIG(ssl)
@@ -46,26 +48,65 @@ QAbstractHttpServerPrivate::QAbstractHttpServerPrivate()
 void QAbstractHttpServerPrivate::handleNewConnections()
 {
     Q_Q(QAbstractHttpServer);
+    auto tcpServer = qobject_cast<QTcpServer *>(q->sender());
+    Q_ASSERT(tcpServer);
 
-#if QT_CONFIG(ssl) && QT_CONFIG(http)
-    if (auto *sslServer = qobject_cast<QSslServer *>(q->sender())) {
-        while (auto socket = qobject_cast<QSslSocket *>(sslServer->nextPendingConnection())) {
-            if (socket->sslConfiguration().nextNegotiatedProtocol()
-                            == QSslConfiguration::ALPNProtocolHTTP2) {
-                new QHttpServerHttp2ProtocolHandler(q, socket, &requestFilter);
-            } else {
-                new QHttpServerHttp1ProtocolHandler(q, socket, &requestFilter);
-            }
+    while (auto socket = tcpServer->nextPendingConnection()) {
+        if (workerPool.isHandOffEnabled())
+            workerPool.handOff(socket);
+        else
+            createProtocolHandler(socket, q);
+    }
+}
+
+#if QT_CONFIG(ssl)
+/*!
+    \internal
+
+    Makes the bound QSslServers hand their connections off to the worker
+    threads before the TLS handshake while hand-off is enabled, and accept
+    them themselves otherwise. Where that is not supported, the handshake
+    runs in the thread of the QSslServer and the encrypted connection is
+    handed off.
+*/
+void QAbstractHttpServerPrivate::updateTlsHandOff()
+{
+    Q_Q(QAbstractHttpServer);
+    const auto sslServers = q->findChildren<QSslServer *>(Qt::FindDirectChildrenOnly);
+    for (QSslServer *sslServer : sslServers) {
+        if (!workerPool.isHandOffEnabled()) {
+            QHttpServerTlsAcceptor::release(sslServer);
+        } else if (sslServer->isListening()
+                   && !QHttpServerTlsAcceptor::takeOver(sslServer, &workerPool)) {
+            qCWarning(lcHttpServer) << "TLS handshakes of" << sslServer
+                                    << "run before the connections are handed off";
         }
-        return;
     }
+}
 #endif
 
-    auto tcpServer = qobject_cast<QTcpServer *>(q->sender());
-    Q_ASSERT(tcpServer);
+/*!
+    \internal
+
+    Creates the protocol handler for the accepted \a socket as a child of
+    \a parent. May be called from a worker thread, in which case \a socket
+    and \a parent live in that thread.
+*/
+QHttpServerStream *QAbstractHttpServerPrivate::createProtocolHandler(QIODevice *socket,
+                                                                    QObject *parent)
+{
+    Q_Q(QAbstractHttpServer);
+
+#if QT_CONFIG(ssl) && QT_CONFIG(http)
+    if (auto *sslSocket = qobject_cast<QSslSocket *>(socket)) {
+        if (sslSocket->sslConfiguration().nextNegotiatedProtocol()
+                        == QSslConfiguration::ALPNProtocolHTTP2) {
+            return new QHttpServerHttp2ProtocolHandler(q, socket, &requestFilter, parent);
+        }
+    }
+#endif
 
-    while (auto socket = tcpServer->nextPendingConnection())
-        new QHttpServerHttp1ProtocolHandler(q, socket, &requestFilter);
+    return new QHttpServerHttp1ProtocolHandler(q, socket, &requestFilter, parent);
 }
 
 /*!
@@ -81,6 +122,18 @@ bool QAbstractHttpServerPrivate::verifyThreadAffinity(const QObject *contextObje
     return true;
 }
 
+/*!
+    \internal
+
+    Returns \c true if the handler of \a request receives the body while it
+    arrives. Called when the headers of a request with a body are complete.
+*/
+bool QAbstractHttpServerPrivate::streamsRequestBody(const QHttpServerRequest &request) const
+{
+    Q_UNUSED(request);
+    return false;
+}
+
 
 #if QT_CONFIG(localserver)
 /*!
@@ -92,8 +145,12 @@ void QAbstractHttpServerPrivate::handleNewLocalConnections()
     auto localServer = qobject_cast<QLocalServer *>(q->sender());
     Q_ASSERT(localServer);
 
-    while (auto socket = localServer->nextPendingConnection())
-        new QHttpServerHttp1ProtocolHandler(q, socket, &requestFilter);
+    while (auto socket = localServer->nextPendingConnection()) {
+        if (workerPool.isHandOffEnabled())
+            workerPool.handOff(socket);
+        else
+            createProtocolHandler(socket, q);
+    }
 }
 #endif
 
@@ -120,9 +177,16 @@ QAbstractHttpServer::QAbstractHttpServer(QObject *parent)
 
 /*!
     Destroys an instance of QAbstractHttpServer.
+
+    \note If worker threads are used, subclasses should call
+    stopWorkerThreads() in their destructor, so that no request is
+    dispatched to a partially destroyed server.
 */
 QAbstractHttpServer::~QAbstractHttpServer()
-    = default;
+{
+    Q_D(QAbstractHttpServer);
+    d->workerPool.stop();
+}
 
 /*!
     \internal
@@ -140,17 +204,22 @@ QAbstractHttpServer::QAbstractHttpServer(QAbstractHttpServerPrivate &dd, QObject
     is listening to.
 
     This function has the same guarantee as QObject::children,
-    the latest server added is the last entry in the vector.
+    the latest server added is the last entry in the vector. The ports
+    the worker threads listen on are appended after them, once per call
+    to listenOnWorkerThreads().
 
     \sa servers()
 */
 QList<quint16> QAbstractHttpServer::serverPorts() const
 {
+    Q_D(const QAbstractHttpServer);
     QList<quint16> ports;
     auto children = findChildren<QTcpServer *>();
-    ports.reserve(children.size());
+    const QList<quint16> workerPorts = d->workerPool.serverPorts();
+    ports.reserve(children.size() + workerPorts.size());
     std::transform(children.cbegin(), children.cend(), std::back_inserter(ports),
                    [](const QTcpServer *server) { return server->serverPort(); });
+    ports.append(workerPorts);
     return ports;
 }
 
@@ -191,6 +260,10 @@ bool QAbstractHttpServer::bind(QTcpServer *server)
     QObjectPrivate::connect(server, &QTcpServer::pendingConnectionAvailable, d,
                             &QAbstractHttpServerPrivate::handleNewConnections,
                             Qt::UniqueConnection);
+#if QT_CONFIG(ssl)
+    if (qobject_cast<QSslServer *>(server))
+        d->updateTlsHandOff();
+#endif
     return true;
 }
 
@@ -233,9 +306,150 @@ bool QAbstractHttpServer::bind(QLocalServer *server)
 }
 #endif
 
+/*!
+    \since 6.10
+
+    Sets the number of worker threads used by listenOnWorkerThreads() to
+    \a count. A \a count of 0 restores the default.
+
+    If the count changes while worker threads are running, they are stopped
+    first, closing their listening sockets and connections.
+
+    \sa workerThreadCount(), listenOnWorkerThreads()
+*/
+void QAbstractHttpServer::setWorkerThreadCount(int count)
+{
+    Q_D(QAbstractHttpServer);
+    d->workerPool.setThreadCount(count);
+}
+
+/*!
+    \since 6.10
+
+    Returns the number of worker threads used by listenOnWorkerThreads().
+    The default is QThread::idealThreadCount().
+
+    \sa setWorkerThreadCount()
+*/
+int QAbstractHttpServer::workerThreadCount() const
+{
+    Q_D(const QAbstractHttpServer);
+    return d->workerPool.threadCount();
+}
+
+/*!
+    \since 6.10
+
+    Starts listening for connections on \a address and \a port in every
+    worker thread. Each worker thread runs its own event loop, owns its own
+    listening socket and handles the connections it accepts itself. The
+    sockets share the port with \c SO_REUSEPORT, so that the operating
+    system spreads the incoming connections over the threads.
+
+    If \a port is 0, a port is chosen automatically; use serverPorts() to
+    find out which one. Returns \c true on success.
+
+    Request handlers, verifiers and the missing handler are called in the
+    worker threads, and must therefore be thread-safe. They, as well as the
+    configuration of this server, should be set up before calling this
+    function. Accepted WebSocket connections are moved to the thread of
+    this server.
+
+    This function is only supported on platforms that provide
+    \c SO_REUSEPORT, and only for unencrypted connections.
+
+    \sa setWorkerThreadCount(), serverPorts()
+*/
+bool QAbstractHttpServer::listenOnWorkerThreads(const QHostAddress &address, quint16 port)
+{
+    Q_D(QAbstractHttpServer);
+    return d->workerPool.listen(address, port);
+}
+
+/*!
+    \since 6.10
+
+    Stops the worker threads and waits for them to finish. Their listening
+    sockets and connections are closed, and no more requests are handled
+    in them. Connections accepted by the servers bound with bind() are
+    handed off to newly started worker threads if hand-off is enabled.
+
+    Subclasses that use worker threads should call this function in their
+    destructor, before any state that request handlers use is destroyed.
+    Does nothing if no worker threads are running.
+
+    \sa listenOnWorkerThreads(), setConnectionHandOffEnabled()
+*/
+void QAbstractHttpServer::stopWorkerThreads()
+{
+    Q_D(QAbstractHttpServer);
+    d->workerPool.stop();
+}
+
+/*!
+    \since 6.10
+
+    If \a enabled is \c true, the connections accepted by the servers bound
+    with bind() are handed off to the worker threads, and their requests are
+    parsed and handled there. Each connection goes to the worker thread with
+    the fewest connections at that time. The worker threads are started with
+    the first connection.
+
+    The same restrictions as for listenOnWorkerThreads() apply to the
+    handlers. Connections of a bound QSslServer are handed off before they
+    are encrypted, and the TLS handshake runs in the worker thread with the
+    QSslServer::sslConfiguration() and QSslServer::handshakeTimeout() of the
+    server. The QSslServer then does not accept these connections itself and
+    does not emit its signals for them.
+
+    Hand-off is disabled by default.
+
+    \sa isConnectionHandOffEnabled(), workerConnectionCounts(),
+    setWorkerThreadCount()
+*/
+void QAbstractHttpServer::setConnectionHandOffEnabled(bool enabled)
+{
+    Q_D(QAbstractHttpServer);
+    d->workerPool.setHandOffEnabled(enabled);
+#if QT_CONFIG(ssl)
+    d->updateTlsHandOff();
+#endif
+}
+
+/*!
+    \since 6.10
+
+    Returns \c true if accepted connections are handed off to the worker
+    threads.
+
+    \sa setConnectionHandOffEnabled()
+*/
+bool QAbstractHttpServer::isConnectionHandOffEnabled() const
+{
+    Q_D(const QAbstractHttpServer);
+    return d->workerPool.isHandOffEnabled();
+}
+
+/*!
+    \since 6.10
+
+    Returns the number of open connections of each running worker thread,
+    or an empty list if no worker threads are running.
+
+    \sa workerThreadCount(), setConnectionHandOffEnabled()
+*/
+QList<int> QAbstractHttpServer::workerConnectionCounts() const
+{
+    Q_D(const QAbstractHttpServer);
+    return d->workerPool.connectionCounts();
+}
+
 /*!
     Returns the TCP and SSL servers this HTTP server will handle connections from.
 
+    The servers of the worker threads are not included, as they live in
+    other threads.
+
     \sa serverPorts()
  */
 QList<QTcpServer *> QAbstractHttpServer::servers() const
@@ -301,7 +515,8 @@ QHttpServerWebSocketUpgradeResponse
 QAbstractHttpServer::verifyWebSocketUpgrade(const QHttpServerRequest &request) const
 {
     Q_D(const QAbstractHttpServer);
-    QScopedValueRollback guard(d->handlingWebSocketUpgrade, true);
+    ++d->handlingWebSocketUpgrade;
+    const auto guard = qScopeGuard([d] { --d->handlingWebSocketUpgrade; });
     for (auto &verifier : d->webSocketUpgradeVerifiers) {
         if (verifier.context && verifier.slotObject && d->verifyThreadAffinity(verifier.context)) {
             auto response = QHttpServerWebSocketUpgradeResponse::passToNext();
@@ -356,7 +571,7 @@ void QAbstractHttpServer::addWebSocketUpgradeVerifierImpl(const QObject *context
     QtPrivate::SlotObjUniquePtr slotObj{slotObjRaw}; // adopts
     Q_ASSERT(slotObj);
     Q_D(QAbstractHttpServer);
-    if (d->handlingWebSocketUpgrade) {
+    if (d->handlingWebSocketUpgrade.load() != 0) {
         qWarning("Registering WebSocket upgrade verifiers while handling them is not allowed");
         return;
     }
@@ -43,6 +43,14 @@ public:
     bool bind(QTcpServer *server);
     QList<QTcpServer *> servers() const;
 
+    void setWorkerThreadCount(int count);
+    int workerThreadCount() const;
+    bool listenOnWorkerThreads(const QHostAddress &address = QHostAddress::Any, quint16 port = 0);
+    void stopWorkerThreads();
+    void setConnectionHandOffEnabled(bool enabled);
+    bool isConnectionHandOffEnabled() const;
+    QList<int> workerConnectionCounts() const;
+
 #if QT_CONFIG(localserver)
     bool bind(QLocalServer *server);
     QList<QLocalServer *> localServers() const;
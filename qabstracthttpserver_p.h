@@ -18,11 +18,13 @@
 #include <QtCore/qglobal.h>
 #include "qhttpserverconfiguration.h"
 #include "qhttpserverrequestfilter_p.h"
+#include "qhttpserverworkerpool_p.h"
 
 #include <private/qobject_p.h>
 
 #include <QtCore/qcoreapplication.h>
 
+#include <atomic>
 #include <vector>
 
 #include "qwebsocketserver.h"
@@ -34,6 +36,8 @@
 QT_BEGIN_NAMESPACE
 
 class QHttpServerRequest;
+class QHttpServerStream;
+class QIODevice;
 
 class QAbstractHttpServerPrivate: public QObjectPrivate
 {
@@ -48,13 +52,18 @@ public:
     };
 
     void handleNewConnections();
+    QHttpServerStream *createProtocolHandler(QIODevice *socket, QObject *parent);
     bool verifyThreadAffinity(const QObject *contextObject) const;
+    virtual bool streamsRequestBody(const QHttpServerRequest &request) const;
 
 #if QT_CONFIG(localserver)
     void handleNewLocalConnections();
 #endif
+#if QT_CONFIG(ssl)
+    void updateTlsHandOff();
+#endif
 
-    mutable bool handlingWebSocketUpgrade = false;
+    mutable std::atomic<int> handlingWebSocketUpgrade = 0;
     struct WebSocketUpgradeVerifier
     {
         QPointer<const QObject> context;
@@ -66,6 +75,7 @@ public:
 #endif
     QHttpServerConfiguration configuration;
     QHttpServerRequestFilter requestFilter;
+    QHttpServerWorkerPool workerPool{this};
 };
 
 QT_END_NAMESPACE
@@ -9,6 +9,8 @@
 #include "qhttpserverresponse.h"
 
 #include "qhttpserver_p.h"
+#include "qhttpserverresponder_p.h"
+#include "qhttpserverrouter_p.h"
 #include "qhttpserverstream_p.h"
 
 #include <QtCore/qloggingcategory.h>
@@ -39,6 +41,11 @@ void QHttpServerPrivate::callMissingHandler(const QHttpServerRequest &request,
     }
 }
 
+bool QHttpServerPrivate::streamsRequestBody(const QHttpServerRequest &request) const
+{
+    return router.d_func()->streamsRequestBody(request);
+}
+
 /*!
     \class QHttpServer
     \since 6.4
@@ -233,11 +240,73 @@ QHttpServer::QHttpServer(QObject *parent)
     until the QHttpServer is destroyed.
 */
 
+/*! \fn template <auto PathPattern, typename Rule = QHttpServerRouterRule, typename Functor> Rule *QHttpServer::route(QHttpServerRequest::Methods method, const QObject *context, Functor &&slot)
+    \since 6.10
+
+    \overload
+
+    Overload of \l QHttpServer::route to create a Rule for a \e PathPattern
+    that is given as a string literal template argument, and \a method. All
+    requests are forwarded to \a context and \a slot.
+
+    The number of \c "<arg>" placeholders in the pattern is checked at
+    compile time: it must equal the number of arguments of \a slot that
+    capture a part of the path. If the pattern ends with a \c{/}, the last
+    argument may have no placeholder, and is matched after the \c{/}. The
+    types of the arguments are checked when the rule is added, like for the
+    other overloads, because converters can be changed at run time.
+
+    The pattern is also split into segments at compile time, so it is not
+    parsed again when the rule is added. This saves time when a large number
+    of routes is added at startup.
+
+    \code
+    server.route<"/user/<arg>/history">(QHttpServerRequest::Method::Get, this,
+                                        [] (qint64 id) { return "hello user"; });
+    \endcode
+
+    This overload is only available with compilers that support class types
+    as non-type template parameters.
+*/
+
+/*! \fn template <auto PathPattern, typename Rule = QHttpServerRouterRule, typename Functor> Rule *QHttpServer::route(const QObject *context, Functor &&slot)
+    \since 6.10
+
+    \overload
+
+    Overload of \l QHttpServer::route to create a Rule for the compile time
+    \e PathPattern and the method \l{QHttpServerRequest::Method::AnyKnown}.
+    All requests are forwarded to \a context and \a slot.
+*/
+
+/*! \fn template <auto PathPattern, typename Rule = QHttpServerRouterRule, typename Functor> Rule *QHttpServer::route(QHttpServerRequest::Methods method, Functor &&handler)
+    \since 6.10
+
+    \overload
+
+    Overload of \l QHttpServer::route to create a Rule for the compile time
+    \e PathPattern and \a method. All requests are forwarded to \a handler.
+    The rule will be valid until the QHttpServer is destroyed.
+*/
+
+/*! \fn template <auto PathPattern, typename Rule = QHttpServerRouterRule, typename Functor> Rule *QHttpServer::route(Functor &&handler)
+    \since 6.10
+
+    \overload
+
+    Overload of \l QHttpServer::route to create a Rule for the compile time
+    \e PathPattern and \l QHttpServerRequest::Method::AnyKnown. All requests
+    are forwarded to \a handler. The rule will be valid until the
+    QHttpServer is destroyed.
+*/
+
 /*!
     Destroys a QHttpServer.
 */
 QHttpServer::~QHttpServer()
 {
+    // Stop the workers before the router goes away
+    stopWorkerThreads();
 }
 
 /*!
@@ -363,7 +432,10 @@ void QHttpServer::sendResponse(QHttpServerResponse &&response, const QHttpServer
 void QHttpServer::sendResponse(QFuture<QHttpServerResponse> &&response,
                                const QHttpServerRequest &request, QHttpServerResponder &&responder)
 {
-    response.then(this,
+    // Continue in the thread of the connection, which is not the thread of
+    // this server if the request came in on a worker thread.
+    QObject *context = responder.d_ptr->stream;
+    response.then(context,
                   [this, &request,
                    responder = std::move(responder)](QHttpServerResponse &&response) mutable {
                       sendResponse(std::move(response), request, std::move(responder));
@@ -122,6 +122,78 @@ public:
     }
 #endif
 
+#if defined(QT_HTTPSERVER_HAS_PATH_PATTERN_LITERALS) || defined(Q_QDOC)
+#ifdef Q_QDOC
+    template <auto PathPattern, typename Rule = QHttpServerRouterRule, typename Functor>
+    Rule *route(QHttpServerRequest::Methods method, const QObject *context, Functor &&slot);
+
+    template <auto PathPattern, typename Rule = QHttpServerRouterRule, typename Functor>
+    Rule *route(const QObject *context, Functor &&slot);
+
+    template <auto PathPattern, typename Rule = QHttpServerRouterRule, typename Functor>
+    Rule *route(QHttpServerRequest::Methods method, Functor &&handler);
+
+    template <auto PathPattern, typename Rule = QHttpServerRouterRule, typename Functor>
+    Rule *route(Functor &&handler);
+#else
+    template<QtPrivate::HttpServerPathPattern PathPattern, typename Rule = QHttpServerRouterRule,
+             typename ViewHandler>
+    Rule *route(QHttpServerRequest::Methods method,
+                const typename QtPrivate::ContextTypeForFunctor<ViewHandler>::ContextType *context,
+                ViewHandler &&viewHandler)
+    {
+        using ViewTraits = QHttpServerRouterViewTraits<ViewHandler>;
+        static_assert(ViewTraits::Arguments::StaticAssert,
+                      "ViewHandler arguments are in the wrong order or not supported");
+        static_assert(PathPattern.acceptsArgumentCount(
+                              qsizetype(ViewTraits::Arguments::CapturableCount)),
+                      "The number of <arg> placeholders in the path pattern does not match "
+                      "the number of ViewHandler arguments to capture them");
+
+        auto routerHandler = createRouteHandler<ViewHandler, ViewTraits>(
+                context, std::forward<ViewHandler>(viewHandler));
+        auto rule = std::make_unique<Rule>(PathPattern.toString(), method, context,
+                                           std::move(routerHandler));
+        if constexpr (PathPattern.isAscii()) {
+            static constexpr auto segments =
+                    PathPattern.template segments<PathPattern.segmentCount()>();
+            return reinterpret_cast<Rule *>(
+                    router()->addRuleWithSegments<ViewTraits>(
+                            std::move(rule), segments.data(), qsizetype(segments.size()),
+                            typename ViewTraits::Arguments::Indexes{}));
+        } else {
+            // The segments are split at run time, where offsets are in UTF-16
+            return reinterpret_cast<Rule *>(
+                    router()->addRule<ViewHandler, ViewTraits>(std::move(rule)));
+        }
+    }
+
+    template<QtPrivate::HttpServerPathPattern PathPattern, typename Rule = QHttpServerRouterRule,
+             typename ViewHandler>
+    Rule *route(const typename QtPrivate::ContextTypeForFunctor<ViewHandler>::ContextType *context,
+                ViewHandler &&viewHandler)
+    {
+        return route<PathPattern, Rule>(QHttpServerRequest::Method::AnyKnown, context,
+                                        std::forward<ViewHandler>(viewHandler));
+    }
+
+    template<QtPrivate::HttpServerPathPattern PathPattern, typename Rule = QHttpServerRouterRule,
+             typename ViewHandler>
+    Rule *route(QHttpServerRequest::Methods method, ViewHandler &&viewHandler)
+    {
+        return route<PathPattern, Rule>(method, this, std::forward<ViewHandler>(viewHandler));
+    }
+
+    template<QtPrivate::HttpServerPathPattern PathPattern, typename Rule = QHttpServerRouterRule,
+             typename ViewHandler>
+    Rule *route(ViewHandler &&viewHandler)
+    {
+        return route<PathPattern, Rule>(QHttpServerRequest::Method::AnyKnown, this,
+                                        std::forward<ViewHandler>(viewHandler));
+    }
+#endif
+#endif
+
 #ifdef Q_QDOC
     template <typename Functor>
     void setMissingHandler(const QObject *context, Functor &&slot);
@@ -48,6 +48,7 @@ public:
     } missingHandler;
 
     void callMissingHandler(const QHttpServerRequest &request, QHttpServerResponder &responder);
+    bool streamsRequestBody(const QHttpServerRequest &request) const override;
 };
 
 QT_END_NAMESPACE
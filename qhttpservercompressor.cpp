@@ -0,0 +1,236 @@
+// Copyright (C) 2025 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+// Qt-Security score:critical reason:data-parser
+
+#include "qhttpservercompressor_p.h"
+
+#include <QtCore/qloggingcategory.h>
+
+#include <limits>
+
+#include <zlib.h>
+
+QT_BEGIN_NAMESPACE
+
+Q_STATIC_LOGGING_CATEGORY(lcHttpServerCompressor, "qt.httpserver.compressor")
+
+/*!
+    \internal
+    \class QHttpServerCompressor
+
+    Compresses a response body with one persistent deflate stream, either
+    in one go or piece by piece for chunked responses.
+*/
+QHttpServerCompressor::QHttpServerCompressor(Coding coding)
+    : stream(std::make_unique<z_stream>())
+{
+    Q_ASSERT(coding != Coding::Identity);
+    // 16 added to the window bits selects the gzip wrapper
+    const int windowBits = coding == Coding::Gzip ? MAX_WBITS + 16 : MAX_WBITS;
+    valid = deflateInit2(stream.get(), Z_DEFAULT_COMPRESSION, Z_DEFLATED, windowBits, 8,
+                         Z_DEFAULT_STRATEGY) == Z_OK;
+    if (!valid)
+        qCWarning(lcHttpServerCompressor, "Could not initialize compression");
+}
+
+QHttpServerCompressor::~QHttpServerCompressor()
+{
+    if (valid)
+        deflateEnd(stream.get());
+}
+
+/*!
+    \internal
+
+    Compresses \a data and flushes the output, so that the client can
+    decompress everything sent so far.
+*/
+QByteArray QHttpServerCompressor::compress(QByteArrayView data)
+{
+    return deflate(data, false);
+}
+
+/*!
+    \internal
+
+    Compresses \a data and ends the compressed stream.
+*/
+QByteArray QHttpServerCompressor::finish(QByteArrayView data)
+{
+    return deflate(data, true);
+}
+
+/*!
+    \internal
+*/
+QByteArray QHttpServerCompressor::deflate(QByteArrayView data, bool last)
+{
+    if (!valid)
+        return QByteArray();
+
+    constexpr qsizetype MaxSize = std::numeric_limits<uInt>::max();
+    QByteArray output;
+    qsizetype used = 0;
+    do {
+        const qsizetype size = qMin(data.size(), MaxSize);
+        stream->next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.data()));
+        stream->avail_in = uInt(size);
+        data = data.sliced(size);
+        const int flush = !data.isEmpty() ? Z_NO_FLUSH : last ? Z_FINISH : Z_SYNC_FLUSH;
+
+        int ret;
+        do {
+            const qsizetype room =
+                    qMin(qsizetype(deflateBound(stream.get(), stream->avail_in)) + 16, MaxSize);
+            output.resize(used + room);
+            stream->next_out = reinterpret_cast<Bytef *>(output.data() + used);
+            stream->avail_out = uInt(room);
+            ret = ::deflate(stream.get(), flush);
+            if (ret == Z_STREAM_ERROR) {
+                qCWarning(lcHttpServerCompressor, "Compression failed");
+                valid = false;
+                return QByteArray();
+            }
+            used += room - stream->avail_out;
+        } while (stream->avail_out == 0 || (flush == Z_FINISH && ret != Z_STREAM_END));
+    } while (!data.isEmpty());
+
+    output.resize(used);
+    return output;
+}
+
+/*!
+    \internal
+
+    Returns the quality in thousandths that the \c Accept-Encoding value
+    \a acceptEncoding gives to \a coding, either by name or through \c{*},
+    or -1 if \a coding is not mentioned.
+*/
+int QHttpServerCompressor::quality(QByteArrayView acceptEncoding, QByteArrayView coding)
+{
+    int wildcard = -1;
+    qsizetype from = 0;
+    while (from <= acceptEncoding.size()) {
+        qsizetype end = acceptEncoding.indexOf(',', from);
+        if (end < 0)
+            end = acceptEncoding.size();
+        const QByteArrayView element = acceptEncoding.sliced(from, end - from);
+        from = end + 1;
+
+        const qsizetype semicolon = element.indexOf(';');
+        const QByteArrayView name =
+                (semicolon < 0 ? element : element.first(semicolon)).trimmed();
+        if (name.isEmpty())
+            continue;
+
+        int q = 1000;
+        if (semicolon >= 0) {
+            const QByteArrayView weight = element.sliced(semicolon + 1).trimmed();
+            if (weight.size() < 3 || (weight[0] != 'q' && weight[0] != 'Q') || weight[1] != '=')
+                continue;
+            // qvalue = ( "0" [ "." 0*3DIGIT ] ) / ( "1" [ "." 0*3("0") ] )
+            const QByteArrayView value = weight.sliced(2);
+            if (value[0] == '1') {
+                q = 1000;
+            } else if (value[0] == '0') {
+                q = 0;
+                if (value.size() > 2 && value[1] == '.') {
+                    int scale = 100;
+                    for (char digit : value.sliced(2).first(qMin(value.size() - 2, 3))) {
+                        if (digit < '0' || digit > '9')
+                            break;
+                        q += (digit - '0') * scale;
+                        scale /= 10;
+                    }
+                }
+            } else {
+                continue;
+            }
+        }
+
+        if (name.compare(coding, Qt::CaseInsensitive) == 0)
+            return q;
+        if (name == "*")
+            wildcard = q;
+    }
+    return wildcard;
+}
+
+/*!
+    \internal
+
+    Returns the content coding that \a acceptEncoding prefers, \c gzip on a
+    tie.
+*/
+QHttpServerCompressor::Coding QHttpServerCompressor::negotiate(QByteArrayView acceptEncoding)
+{
+    const int gzip = quality(acceptEncoding, "gzip");
+    const int deflate = quality(acceptEncoding, "deflate");
+    const int best = qMax(gzip, deflate);
+    if (best <= 0 || quality(acceptEncoding, "identity") > best)
+        return Coding::Identity;
+    return gzip == best ? Coding::Gzip : Coding::Deflate;
+}
+
+/*!
+    \internal
+*/
+QByteArray QHttpServerCompressor::name(Coding coding)
+{
+    switch (coding) {
+    case Coding::Gzip:
+        return QByteArrayLiteral("gzip");
+    case Coding::Deflate:
+        return QByteArrayLiteral("deflate");
+    case Coding::Identity:
+        break;
+    }
+    return QByteArrayLiteral("identity");
+}
+
+/*!
+    \internal
+
+    Returns \c true if the content of the MIME type \a mimeType is worth
+    compressing. Images, audio, video and archives are compressed already.
+*/
+bool QHttpServerCompressor::isCompressible(QByteArrayView mimeType)
+{
+    const qsizetype semicolon = mimeType.indexOf(';');
+    if (semicolon >= 0)
+        mimeType = mimeType.first(semicolon);
+    mimeType = mimeType.trimmed();
+
+    if (mimeType.startsWith("text/"))
+        return true;
+    if (mimeType.endsWith("+json") || mimeType.endsWith("+xml"))
+        return true;
+
+    static constexpr QByteArrayView compressible[] = {
+        "application/javascript",
+        "application/json",
+        "application/wasm",
+        "application/x-javascript",
+        "application/xml",
+        "image/x-icon",
+    };
+    for (QByteArrayView type : compressible) {
+        if (mimeType.compare(type, Qt::CaseInsensitive) == 0)
+            return true;
+    }
+    return false;
+}
+
+/*!
+    \internal
+
+    Returns \a data compressed with \a coding, or a null QByteArray on
+    failure.
+*/
+QByteArray QHttpServerCompressor::compressed(QByteArrayView data, Coding coding)
+{
+    QHttpServerCompressor compressor(coding);
+    return compressor.finish(data);
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,58 @@
+// Copyright (C) 2025 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+// Qt-Security score:significant reason:default
+
+#pragma once
+
+#include <QtCore/qglobal.h>
+#include <QtCore/qbytearray.h>
+#include <QtCore/qbytearrayview.h>
+
+#include <memory>
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists for the convenience
+// of QHttpServer. This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+
+struct z_stream_s;
+
+QT_BEGIN_NAMESPACE
+
+class QHttpServerCompressor
+{
+    Q_DISABLE_COPY_MOVE(QHttpServerCompressor)
+
+public:
+    enum class Coding {
+        Identity,
+        Gzip,
+        Deflate,
+    };
+
+    explicit QHttpServerCompressor(Coding coding);
+    ~QHttpServerCompressor();
+
+    bool isValid() const { return valid; }
+    QByteArray compress(QByteArrayView data);
+    QByteArray finish(QByteArrayView data);
+
+    static int quality(QByteArrayView acceptEncoding, QByteArrayView coding);
+    static Coding negotiate(QByteArrayView acceptEncoding);
+    static QByteArray name(Coding coding);
+    static bool isCompressible(QByteArrayView mimeType);
+    static QByteArray compressed(QByteArrayView data, Coding coding);
+
+private:
+    QByteArray deflate(QByteArrayView data, bool last);
+
+    std::unique_ptr<z_stream_s> stream;
+    bool valid = false;
+};
+
+QT_END_NAMESPACE
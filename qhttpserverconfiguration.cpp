@@ -16,6 +16,16 @@ class QHttpServerConfigurationPrivate : public QSharedData
 {
 public:
     quint32 rateLimit = 0;
+    bool dateHeader = false;
+    QByteArray serverHeader;
+    bool compression = false;
+    qsizetype compressionThreshold = 1024;
+    qint64 requestBodyFileThreshold = 0;
+    qsizetype maxUrlLength = 8 * 1024;
+    qsizetype maxHeaderSize = 64 * 1024;
+    qsizetype maxHeaderCount = 100;
+    qint64 maxBodySize = 0;
+    bool lazyRequestHeaders = false;
 };
 
 QT_DEFINE_QESDP_SPECIALIZATION_DTOR(QHttpServerConfigurationPrivate)
@@ -26,6 +36,13 @@ QT_DEFINE_QESDP_SPECIALIZATION_DTOR(QHttpServerConfigurationPrivate)
     Such a configuration has the following values:
      \list
          \li Rate limit is disabled
+         \li No Date header is added to responses
+         \li No Server header is added to responses
+         \li Responses are not compressed
+         \li Request bodies are kept in memory
+         \li URLs of up to 8 KiB, header blocks of up to 64 KiB with up to
+             100 fields, and bodies of any size are accepted
+         \li QHttpServerRequest::headers() is built for every request
      \endlist
 */
 QHttpServerConfiguration::QHttpServerConfiguration()
@@ -86,6 +103,308 @@ quint32 QHttpServerConfiguration::rateLimitPerSecond() const
     return d->rateLimit;
 }
 
+/*!
+    \since 6.10
+
+    Sets whether a \c Date header with the current time is added to every
+    response that does not have one already to \a enabled.
+
+    The value is formatted once per second and thread, so adding it costs
+    little more than copying it.
+
+    \sa isDateHeaderEnabled(), setServerHeader()
+*/
+void QHttpServerConfiguration::setDateHeaderEnabled(bool enabled)
+{
+    d.detach();
+    d->dateHeader = enabled;
+}
+
+/*!
+    \since 6.10
+
+    Returns \c true if a \c Date header is added to the responses.
+
+    \sa setDateHeaderEnabled()
+*/
+bool QHttpServerConfiguration::isDateHeaderEnabled() const
+{
+    return d->dateHeader;
+}
+
+/*!
+    \since 6.10
+
+    Sets \a value as the \c Server header that is added to every response
+    that does not have one already. An empty \a value, which is the
+    default, adds no \c Server header.
+
+    \sa serverHeader(), setDateHeaderEnabled()
+*/
+void QHttpServerConfiguration::setServerHeader(const QByteArray &value)
+{
+    d.detach();
+    d->serverHeader = value;
+}
+
+/*!
+    \since 6.10
+
+    Returns the value of the \c Server header added to the responses.
+
+    \sa setServerHeader()
+*/
+QByteArray QHttpServerConfiguration::serverHeader() const
+{
+    return d->serverHeader;
+}
+
+/*!
+    \since 6.10
+
+    Sets whether response bodies are compressed to \a enabled.
+
+    If enabled, a response is compressed with \c gzip or \c deflate when
+    the \c Accept-Encoding header of the request allows it, its
+    \c Content-Type is text or another compressible type, it has no
+    \c Content-Encoding yet, and its body has at least
+    compressionThreshold() bytes. Chunked responses are compressed
+    incrementally, regardless of the threshold.
+
+    Compression is disabled by default.
+
+    \sa isCompressionEnabled(), setCompressionThreshold()
+*/
+void QHttpServerConfiguration::setCompressionEnabled(bool enabled)
+{
+    d.detach();
+    d->compression = enabled;
+}
+
+/*!
+    \since 6.10
+
+    Returns \c true if response bodies are compressed.
+
+    \sa setCompressionEnabled()
+*/
+bool QHttpServerConfiguration::isCompressionEnabled() const
+{
+    return d->compression;
+}
+
+/*!
+    \since 6.10
+
+    Sets the size in \a bytes of the smallest response body that is
+    compressed. Smaller bodies are not worth the time it takes to compress
+    them. The default is 1024 bytes.
+
+    \sa compressionThreshold(), setCompressionEnabled()
+*/
+void QHttpServerConfiguration::setCompressionThreshold(qsizetype bytes)
+{
+    d.detach();
+    d->compressionThreshold = bytes;
+}
+
+/*!
+    \since 6.10
+
+    Returns the size in bytes of the smallest response body that is
+    compressed.
+
+    \sa setCompressionThreshold()
+*/
+qsizetype QHttpServerConfiguration::compressionThreshold() const
+{
+    return d->compressionThreshold;
+}
+
+/*!
+    \since 6.10
+
+    Sets the size in \a bytes above which a request body is written to a
+    temporary file while it is received, instead of being kept in memory.
+    This limits the memory taken by large uploads. A threshold of 0, which
+    is the default, keeps all bodies in memory.
+
+    The body of such a request is read from
+    QHttpServerRequest::bodyDevice(), which is the temporary file.
+    QHttpServerRequest::body() reads the whole file into memory.
+
+    \sa requestBodyFileThreshold()
+*/
+void QHttpServerConfiguration::setRequestBodyFileThreshold(qint64 bytes)
+{
+    d.detach();
+    d->requestBodyFileThreshold = bytes;
+}
+
+/*!
+    \since 6.10
+
+    Returns the size in bytes above which a request body is written to a
+    temporary file, or 0 if bodies are always kept in memory.
+
+    \sa setRequestBodyFileThreshold()
+*/
+qint64 QHttpServerConfiguration::requestBodyFileThreshold() const
+{
+    return d->requestBodyFileThreshold;
+}
+
+/*!
+    \since 6.10
+
+    Sets the maximum \a length of the URL in a request. A request with a
+    longer URL is answered with \c{414 URI Too Long} and the connection is
+    closed, without reading the rest of the request. A \a length of 0
+    accepts URLs of any length. The default is 8 KiB.
+
+    \sa maxUrlLength(), setMaxHeaderSize()
+*/
+void QHttpServerConfiguration::setMaxUrlLength(qsizetype length)
+{
+    d.detach();
+    d->maxUrlLength = length;
+}
+
+/*!
+    \since 6.10
+
+    Returns the maximum length of the URL in a request, or 0 if it is not
+    limited.
+
+    \sa setMaxUrlLength()
+*/
+qsizetype QHttpServerConfiguration::maxUrlLength() const
+{
+    return d->maxUrlLength;
+}
+
+/*!
+    \since 6.10
+
+    Sets the maximum size in \a bytes of the header block of a request. A
+    request with a larger header block is answered with
+    \c{431 Request Header Fields Too Large} and the connection is closed,
+    as soon as the limit is exceeded. A size of 0 accepts header blocks of
+    any size. The default is 64 KiB.
+
+    \sa maxHeaderSize(), setMaxHeaderCount()
+*/
+void QHttpServerConfiguration::setMaxHeaderSize(qsizetype bytes)
+{
+    d.detach();
+    d->maxHeaderSize = bytes;
+}
+
+/*!
+    \since 6.10
+
+    Returns the maximum size in bytes of the header block of a request, or 0
+    if it is not limited.
+
+    \sa setMaxHeaderSize()
+*/
+qsizetype QHttpServerConfiguration::maxHeaderSize() const
+{
+    return d->maxHeaderSize;
+}
+
+/*!
+    \since 6.10
+
+    Sets the maximum number of header fields in a request to \a count. A
+    request with more fields is answered with
+    \c{431 Request Header Fields Too Large} and the connection is closed. A
+    \a count of 0 accepts any number of fields. The default is 100.
+
+    \sa maxHeaderCount(), setMaxHeaderSize()
+*/
+void QHttpServerConfiguration::setMaxHeaderCount(qsizetype count)
+{
+    d.detach();
+    d->maxHeaderCount = count;
+}
+
+/*!
+    \since 6.10
+
+    Returns the maximum number of header fields in a request, or 0 if it is
+    not limited.
+
+    \sa setMaxHeaderCount()
+*/
+qsizetype QHttpServerConfiguration::maxHeaderCount() const
+{
+    return d->maxHeaderCount;
+}
+
+/*!
+    \since 6.10
+
+    Sets the maximum size in \a bytes of a request body. A request whose
+    \c Content-Length is larger is answered with
+    \c{413 Content Too Large} and the connection is closed before the body
+    is read. A chunked body is rejected as soon as a chunk would exceed the
+    limit. A size of 0, which is the default, accepts bodies of any size.
+
+    \sa maxBodySize(), setRequestBodyFileThreshold()
+*/
+void QHttpServerConfiguration::setMaxBodySize(qint64 bytes)
+{
+    d.detach();
+    d->maxBodySize = bytes;
+}
+
+/*!
+    \since 6.10
+
+    Returns the maximum size in bytes of a request body, or 0 if it is not
+    limited.
+
+    \sa setMaxBodySize()
+*/
+qint64 QHttpServerConfiguration::maxBodySize() const
+{
+    return d->maxBodySize;
+}
+
+/*!
+    \since 6.10
+
+    Sets whether QHttpServerRequest::headers() is only built when it is
+    first called to \a enabled. The default is \c false, which builds it
+    for every request, when its header block has been received.
+
+    If enabled, requests whose handlers only read the header fields with
+    QHttpServerRequest::value() or the raw header accessors, such as
+    QHttpServerRequest::rawHeaderValue(), never copy the fields out of the
+    received header block, which saves an allocation per field.
+
+    \sa isLazyRequestHeadersEnabled()
+*/
+void QHttpServerConfiguration::setLazyRequestHeadersEnabled(bool enabled)
+{
+    d.detach();
+    d->lazyRequestHeaders = enabled;
+}
+
+/*!
+    \since 6.10
+
+    Returns \c true if QHttpServerRequest::headers() is only built when it
+    is first called.
+
+    \sa setLazyRequestHeadersEnabled()
+*/
+bool QHttpServerConfiguration::isLazyRequestHeadersEnabled() const
+{
+    return d->lazyRequestHeaders;
+}
+
 /*!
     \fn void QHttpServerConfiguration::swap(QHttpServerConfiguration &other)
     \memberswap{configuration}
@@ -111,7 +430,17 @@ bool comparesEqual(const QHttpServerConfiguration &lhs, const QHttpServerConfigu
     if (lhs.d == rhs.d)
         return true;
 
-    return lhs.d->rateLimit == rhs.d->rateLimit;
+    return lhs.d->rateLimit == rhs.d->rateLimit
+            && lhs.d->dateHeader == rhs.d->dateHeader
+            && lhs.d->serverHeader == rhs.d->serverHeader
+            && lhs.d->compression == rhs.d->compression
+            && lhs.d->compressionThreshold == rhs.d->compressionThreshold
+            && lhs.d->requestBodyFileThreshold == rhs.d->requestBodyFileThreshold
+            && lhs.d->maxUrlLength == rhs.d->maxUrlLength
+            && lhs.d->maxHeaderSize == rhs.d->maxHeaderSize
+            && lhs.d->maxHeaderCount == rhs.d->maxHeaderCount
+            && lhs.d->maxBodySize == rhs.d->maxBodySize
+            && lhs.d->lazyRequestHeaders == rhs.d->lazyRequestHeaders;
 }
 
 QT_END_NAMESPACE
@@ -6,6 +6,7 @@
 
 #include <QtCore/qglobal.h>
 
+#include <QtCore/qbytearray.h>
 #include <QtCore/qshareddata.h>
 
 QT_BEGIN_NAMESPACE
@@ -29,6 +30,36 @@ public:
     void setRateLimitPerSecond(quint32 maxRequests);
     quint32 rateLimitPerSecond() const;
 
+    void setDateHeaderEnabled(bool enabled);
+    bool isDateHeaderEnabled() const;
+
+    void setServerHeader(const QByteArray &value);
+    QByteArray serverHeader() const;
+
+    void setCompressionEnabled(bool enabled);
+    bool isCompressionEnabled() const;
+
+    void setCompressionThreshold(qsizetype bytes);
+    qsizetype compressionThreshold() const;
+
+    void setRequestBodyFileThreshold(qint64 bytes);
+    qint64 requestBodyFileThreshold() const;
+
+    void setMaxUrlLength(qsizetype length);
+    qsizetype maxUrlLength() const;
+
+    void setMaxHeaderSize(qsizetype bytes);
+    qsizetype maxHeaderSize() const;
+
+    void setMaxHeaderCount(qsizetype count);
+    qsizetype maxHeaderCount() const;
+
+    void setMaxBodySize(qint64 bytes);
+    qint64 maxBodySize() const;
+
+    void setLazyRequestHeadersEnabled(bool enabled);
+    bool isLazyRequestHeadersEnabled() const;
+
 private:
     QExplicitlySharedDataPointer<QHttpServerConfigurationPrivate> d;
 
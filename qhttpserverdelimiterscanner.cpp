@@ -0,0 +1,127 @@
+// Copyright (C) 2024 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+// Qt-Security score:critical reason:network-protocol
+
+#include "qhttpserverdelimiterscanner_p.h"
+
+#include <QtCore/qalgorithms.h>
+#include <QtCore/private/qsimd_p.h>
+
+#include <cstring>
+
+QT_BEGIN_NAMESPACE
+
+namespace {
+
+// The scanner compares against at most this many delimiters at once. The
+// HTTP/1 parser never needs more than that.
+constexpr qsizetype MaxDelimiters = 4;
+
+const char *findAnyScalar(const char *p, const char *end, const char *delimiters,
+                          qsizetype count)
+{
+    for (; p != end; ++p) {
+        for (qsizetype i = 0; i < count; ++i) {
+            if (*p == delimiters[i])
+                return p;
+        }
+    }
+    return end;
+}
+
+#ifdef __SSE2__
+const char *findAnySse2(const char *p, const char *end, const char *delimiters,
+                        qsizetype count)
+{
+    __m128i needles[MaxDelimiters];
+    for (qsizetype i = 0; i < count; ++i)
+        needles[i] = _mm_set1_epi8(delimiters[i]);
+
+    for (; end - p >= 16; p += 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        __m128i matches = _mm_cmpeq_epi8(chunk, needles[0]);
+        for (qsizetype i = 1; i < count; ++i)
+            matches = _mm_or_si128(matches, _mm_cmpeq_epi8(chunk, needles[i]));
+        if (const uint mask = uint(_mm_movemask_epi8(matches)))
+            return p + qCountTrailingZeroBits(mask);
+    }
+    return findAnyScalar(p, end, delimiters, count);
+}
+#endif
+
+#if defined(Q_PROCESSOR_X86) && QT_COMPILER_SUPPORTS_HERE(AVX2)
+QT_FUNCTION_TARGET(AVX2)
+const char *findAnyAvx2(const char *p, const char *end, const char *delimiters,
+                        qsizetype count)
+{
+    __m256i needles[MaxDelimiters];
+    for (qsizetype i = 0; i < count; ++i)
+        needles[i] = _mm256_set1_epi8(delimiters[i]);
+
+    for (; end - p >= 32; p += 32) {
+        const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        __m256i matches = _mm256_cmpeq_epi8(chunk, needles[0]);
+        for (qsizetype i = 1; i < count; ++i)
+            matches = _mm256_or_si256(matches, _mm256_cmpeq_epi8(chunk, needles[i]));
+        if (const uint mask = uint(_mm256_movemask_epi8(matches)))
+            return p + qCountTrailingZeroBits(mask);
+    }
+#  ifdef __SSE2__
+    return findAnySse2(p, end, delimiters, count);
+#  else
+    return findAnyScalar(p, end, delimiters, count);
+#  endif
+}
+#endif
+
+const char *findAny(const char *p, const char *end, const char *delimiters, qsizetype count)
+{
+#if defined(Q_PROCESSOR_X86) && QT_COMPILER_SUPPORTS_HERE(AVX2)
+    if (end - p >= 32 && qCpuHasFeature(AVX2))
+        return findAnyAvx2(p, end, delimiters, count);
+#endif
+#ifdef __SSE2__
+    return findAnySse2(p, end, delimiters, count);
+#else
+    return findAnyScalar(p, end, delimiters, count);
+#endif
+}
+
+} // anonymous namespace
+
+/*!
+    \internal
+
+    Returns the index of the first byte in \a data at or after \a from that is
+    equal to any of the bytes in \a delimiters, or -1 if there is none.
+
+    A single delimiter is looked up with memchr(), which the C library already
+    vectorizes. For up to four delimiters the bytes are compared 32 (AVX2) or
+    16 (SSE2) at a time, depending on what the CPU supports at runtime, with a
+    scalar loop for the remaining bytes and for other architectures.
+*/
+qsizetype QHttpServerDelimiterScanner::indexOfAny(QByteArrayView data, QByteArrayView delimiters,
+                                                  qsizetype from)
+{
+    Q_ASSERT(!delimiters.isEmpty() && delimiters.size() <= MaxDelimiters);
+
+    if (from < 0)
+        from = qMax(from + data.size(), qsizetype(0));
+    if (from >= data.size())
+        return -1;
+
+    const char *begin = data.data();
+    const char *end = begin + data.size();
+    const char *p;
+    if (delimiters.size() == 1) {
+        p = static_cast<const char *>(std::memchr(begin + from, delimiters.front(),
+                                                  size_t(data.size() - from)));
+        if (!p)
+            p = end;
+    } else {
+        p = findAny(begin + from, end, delimiters.data(), delimiters.size());
+    }
+    return p == end ? -1 : p - begin;
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,28 @@
+// Copyright (C) 2024 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+// Qt-Security score:critical reason:network-protocol
+
+#pragma once
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists for the convenience
+// of QHttpServer. This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+
+#include <QtCore/qglobal.h>
+#include <QtCore/qbytearrayview.h>
+
+QT_BEGIN_NAMESPACE
+
+namespace QHttpServerDelimiterScanner {
+
+qsizetype indexOfAny(QByteArrayView data, QByteArrayView delimiters, qsizetype from = 0);
+
+}
+
+QT_END_NAMESPACE
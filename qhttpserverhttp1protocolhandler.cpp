@@ -4,13 +4,17 @@
 
 #include "qhttpserverhttp1protocolhandler_p.h"
 
+#include <QtCore/qfile.h>
 #include <QtCore/qloggingcategory.h>
 #include <QtCore/qmetaobject.h>
 #include <QtCore/qthread.h>
 #include <QtCore/qpointer.h>
+#include <QtCore/qsocketnotifier.h>
 #include "qabstracthttpserver.h"
 #include "qhttpserverrequest.h"
 #include "qhttpserverresponder.h"
+#include "qhttpserverresponder_p.h"
+#include "qhttpserverrangedevice_p.h"
 #include "qhttpserverresponse.h"
 #if QT_CONFIG(localserver)
 #include <QtNetwork/qlocalsocket.h>
@@ -21,77 +25,128 @@
 #include "qhttpserverliterals_p.h"
 #include "qhttpserverrequest_p.h"
 
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#if defined(Q_OS_UNIX)
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include <cerrno>
+#endif
+#if defined(Q_OS_LINUX)
+#include <sys/sendfile.h>
+#endif
+
 QT_BEGIN_NAMESPACE
 
 Q_STATIC_LOGGING_CATEGORY(lcHttpServerHttp1Handler, "qt.httpserver.http1handler")
 
+// How much the socket buffers while the body of a request is streamed
+static constexpr qint64 StreamingReadBufferSize = 64 * 1024;
+// How many requests of a connection are handled at the same time
+static constexpr qsizetype MaxPipelinedRequests = 16;
+
 // https://www.w3.org/Protocols/rfc2616/rfc2616-sec10.html
-static const std::map<QHttpServerResponder::StatusCode, QByteArray> statusString{
-#define XX(name, string) { QHttpServerResponder::StatusCode::name, QByteArrayLiteral(string) }
-    XX(Continue, "Continue"),
-    XX(SwitchingProtocols, "Switching Protocols"),
-    XX(Processing, "Processing"),
-    XX(Ok, "OK"),
-    XX(Created, "Created"),
-    XX(Accepted, "Accepted"),
-    XX(NonAuthoritativeInformation, "Non-Authoritative Information"),
-    XX(NoContent, "No Content"),
-    XX(ResetContent, "Reset Content"),
-    XX(PartialContent, "Partial Content"),
-    XX(MultiStatus, "Multi-Status"),
-    XX(AlreadyReported, "Already Reported"),
-    XX(IMUsed, "I'm Used"),
-    XX(MultipleChoices, "Multiple Choices"),
-    XX(MovedPermanently, "Moved Permanently"),
-    XX(Found, "Found"),
-    XX(SeeOther, "See Other"),
-    XX(NotModified, "Not Modified"),
-    XX(UseProxy, "Use Proxy"),
-    XX(TemporaryRedirect, "Temporary Redirect"),
-    XX(PermanentRedirect, "Permanent Redirect"),
-    XX(BadRequest, "Bad Request"),
-    XX(Unauthorized, "Unauthorized"),
-    XX(PaymentRequired, "Payment Required"),
-    XX(Forbidden, "Forbidden"),
-    XX(NotFound, "Not Found"),
-    XX(MethodNotAllowed, "Method Not Allowed"),
-    XX(NotAcceptable, "Not Acceptable"),
-    XX(ProxyAuthenticationRequired, "Proxy Authentication Required"),
-    XX(RequestTimeout, "Request Timeout"),
-    XX(Conflict, "Conflict"),
-    XX(Gone, "Gone"),
-    XX(LengthRequired, "Length Required"),
-    XX(PreconditionFailed, "Precondition Failed"),
-    XX(PayloadTooLarge, "Request Entity Too Large"),
-    XX(UriTooLong, "Request-URI Too Long"),
-    XX(UnsupportedMediaType, "Unsupported Media Type"),
-    XX(RequestRangeNotSatisfiable, "Requested Range Not Satisfiable"),
-    XX(ExpectationFailed, "Expectation Failed"),
-    XX(ImATeapot, "I'm a teapot"),
-    XX(MisdirectedRequest, "Misdirected Request"),
-    XX(UnprocessableEntity, "Unprocessable Entity"),
-    XX(Locked, "Locked"),
-    XX(FailedDependency, "Failed Dependency"),
-    XX(UpgradeRequired, "Upgrade Required"),
-    XX(PreconditionRequired, "Precondition Required"),
-    XX(TooManyRequests, "Too Many Requests"),
-    XX(RequestHeaderFieldsTooLarge, "Request Header Fields Too Large"),
-    XX(UnavailableForLegalReasons, "Unavailable For Legal Reasons"),
-    XX(InternalServerError, "Internal Server Error"),
-    XX(NotImplemented, "Not Implemented"),
-    XX(BadGateway, "Bad Gateway"),
-    XX(ServiceUnavailable, "Service Unavailable"),
-    XX(GatewayTimeout, "Gateway Timeout"),
-    XX(HttpVersionNotSupported, "HTTP Version Not Supported"),
-    XX(VariantAlsoNegotiates, "Variant Also Negotiates"),
-    XX(InsufficientStorage, "Insufficient Storage"),
-    XX(LoopDetected, "Loop Detected"),
-    XX(NotExtended, "Not Extended"),
-    XX(NetworkAuthenticationRequired, "Network Authentication Required"),
-    XX(NetworkConnectTimeoutError, "Network Connect Timeout Error"),
+struct QHttpServerHttp1StatusLine
+{
+    QHttpServerResponder::StatusCode status;
+    QByteArrayView line;
+};
+
+static constexpr QHttpServerHttp1StatusLine statusLines[] = {
+#define XX(name, code, string) \
+    { QHttpServerResponder::StatusCode::name, "HTTP/1.1 " #code " " string "\r\n" }
+    XX(Continue, 100, "Continue"),
+    XX(SwitchingProtocols, 101, "Switching Protocols"),
+    XX(Processing, 102, "Processing"),
+    XX(Ok, 200, "OK"),
+    XX(Created, 201, "Created"),
+    XX(Accepted, 202, "Accepted"),
+    XX(NonAuthoritativeInformation, 203, "Non-Authoritative Information"),
+    XX(NoContent, 204, "No Content"),
+    XX(ResetContent, 205, "Reset Content"),
+    XX(PartialContent, 206, "Partial Content"),
+    XX(MultiStatus, 207, "Multi-Status"),
+    XX(AlreadyReported, 208, "Already Reported"),
+    XX(IMUsed, 226, "I'm Used"),
+    XX(MultipleChoices, 300, "Multiple Choices"),
+    XX(MovedPermanently, 301, "Moved Permanently"),
+    XX(Found, 302, "Found"),
+    XX(SeeOther, 303, "See Other"),
+    XX(NotModified, 304, "Not Modified"),
+    XX(UseProxy, 305, "Use Proxy"),
+    XX(TemporaryRedirect, 307, "Temporary Redirect"),
+    XX(PermanentRedirect, 308, "Permanent Redirect"),
+    XX(BadRequest, 400, "Bad Request"),
+    XX(Unauthorized, 401, "Unauthorized"),
+    XX(PaymentRequired, 402, "Payment Required"),
+    XX(Forbidden, 403, "Forbidden"),
+    XX(NotFound, 404, "Not Found"),
+    XX(MethodNotAllowed, 405, "Method Not Allowed"),
+    XX(NotAcceptable, 406, "Not Acceptable"),
+    XX(ProxyAuthenticationRequired, 407, "Proxy Authentication Required"),
+    XX(RequestTimeout, 408, "Request Timeout"),
+    XX(Conflict, 409, "Conflict"),
+    XX(Gone, 410, "Gone"),
+    XX(LengthRequired, 411, "Length Required"),
+    XX(PreconditionFailed, 412, "Precondition Failed"),
+    XX(PayloadTooLarge, 413, "Request Entity Too Large"),
+    XX(UriTooLong, 414, "Request-URI Too Long"),
+    XX(UnsupportedMediaType, 415, "Unsupported Media Type"),
+    XX(RequestRangeNotSatisfiable, 416, "Requested Range Not Satisfiable"),
+    XX(ExpectationFailed, 417, "Expectation Failed"),
+    XX(ImATeapot, 418, "I'm a teapot"),
+    XX(MisdirectedRequest, 421, "Misdirected Request"),
+    XX(UnprocessableEntity, 422, "Unprocessable Entity"),
+    XX(Locked, 423, "Locked"),
+    XX(FailedDependency, 424, "Failed Dependency"),
+    XX(UpgradeRequired, 426, "Upgrade Required"),
+    XX(PreconditionRequired, 428, "Precondition Required"),
+    XX(TooManyRequests, 429, "Too Many Requests"),
+    XX(RequestHeaderFieldsTooLarge, 431, "Request Header Fields Too Large"),
+    XX(UnavailableForLegalReasons, 451, "Unavailable For Legal Reasons"),
+    XX(InternalServerError, 500, "Internal Server Error"),
+    XX(NotImplemented, 501, "Not Implemented"),
+    XX(BadGateway, 502, "Bad Gateway"),
+    XX(ServiceUnavailable, 503, "Service Unavailable"),
+    XX(GatewayTimeout, 504, "Gateway Timeout"),
+    XX(HttpVersionNotSupported, 505, "HTTP Version Not Supported"),
+    XX(VariantAlsoNegotiates, 506, "Variant Also Negotiates"),
+    XX(InsufficientStorage, 507, "Insufficient Storage"),
+    XX(LoopDetected, 508, "Loop Detected"),
+    XX(NotExtended, 510, "Not Extended"),
+    XX(NetworkAuthenticationRequired, 511, "Network Authentication Required"),
+    XX(NetworkConnectTimeoutError, 599, "Network Connect Timeout Error"),
 #undef XX
 };
 
+static constexpr int FirstStatusCode = 100;
+static constexpr int LastStatusCode = 599;
+
+// Checks that the code in each line is the value of its status
+static constexpr bool statusLinesMatchCodes()
+{
+    for (const auto &entry : statusLines) {
+        int code = 0;
+        for (qsizetype i = 9; i < 12; ++i)
+            code = code * 10 + (entry.line[i] - '0');
+        if (code != int(entry.status) || code < FirstStatusCode || code > LastStatusCode)
+            return false;
+    }
+    return true;
+}
+static_assert(statusLinesMatchCodes());
+
+// The status lines indexed by status code, empty for unknown codes
+static constexpr auto statusLineTable = [] {
+    std::array<QByteArrayView, LastStatusCode - FirstStatusCode + 1> table = {};
+    for (const auto &entry : statusLines)
+        table[int(entry.status) - FirstStatusCode] = entry.line;
+    return table;
+}();
+
 template <qint64 BUFFERSIZE = 128 * 1024>
 struct QHttpServerHttp1IOChunkedTransfer
 {
@@ -258,10 +313,118 @@ struct QHttpServerHttp1IOChunkedTransfer
     }
 };
 
+#if defined(Q_OS_LINUX)
+// Sends a file to a plain TCP socket with sendfile(), so that the data goes
+// from the page cache to the socket without being copied to user space.
+struct QHttpServerHttp1SendFileTransfer
+{
+    // Used when the socket cannot take more data at the moment, so that the
+    // socket waits for it to become writable again
+    static constexpr qint64 fallbackBlockSize = 64 * 1024;
+    static constexpr qint64 maxSendSize = 1024 * 1024 * 1024;
+
+    QPointer<QFile> source;
+    // The device handed to the handler, which is source or owns it
+    const QPointer<QIODevice> owner;
+    const QPointer<QTcpSocket> sink;
+    QPointer<QHttpServerHttp1ProtocolHandler> handler;
+    qint64 offset;
+    qint64 remaining;
+    QMetaObject::Connection bytesWrittenConnection;
+
+    QHttpServerHttp1SendFileTransfer(QFile *input, qint64 from, qint64 length,
+                                     QIODevice *inputOwner, QTcpSocket *output,
+                                     QHttpServerHttp1ProtocolHandler *callback)
+        : source(input),
+          owner(inputOwner),
+          sink(output),
+          handler(callback),
+          offset(from),
+          remaining(length)
+    {
+        bytesWrittenConnection = QObject::connect(sink.data(), &QIODevice::bytesWritten,
+                                                  source.data(), [this]() { send(); });
+        QObject::connect(sink.data(), &QObject::destroyed, owner.data(), &QObject::deleteLater);
+        QObject::connect(source.data(), &QObject::destroyed, source.data(), [this]() {
+            delete this;
+        });
+        send();
+    }
+
+    ~QHttpServerHttp1SendFileTransfer()
+    {
+        QObject::disconnect(bytesWrittenConnection);
+    }
+
+    void send()
+    {
+        if (sink.isNull() || source.isNull())
+            return;
+
+        while (remaining > 0) {
+            // Keep the order of the data buffered in the socket
+            if (sink->bytesToWrite() > 0)
+                return;
+
+            off_t position = off_t(offset);
+            const ssize_t sent = ::sendfile(int(sink->socketDescriptor()), source->handle(),
+                                            &position, size_t(qMin(remaining, maxSendSize)));
+            if (sent > 0) {
+                offset += sent;
+                remaining -= sent;
+                continue;
+            }
+            if (sent == -1 && errno == EINTR)
+                continue;
+            if (sent == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                writeBlock();
+                return;
+            }
+
+            // The file shrank, or the connection is gone. The promised
+            // Content-Length cannot be kept, so the connection is closed.
+            qCWarning(lcHttpServerHttp1Handler, "Error sending file: %s",
+                      sent == 0 ? "unexpected end of file" : strerror(errno));
+            sink->abort();
+            break;
+        }
+        complete();
+    }
+
+    void writeBlock()
+    {
+        if (!source->seek(offset)) {
+            sink->abort();
+            complete();
+            return;
+        }
+        const QByteArray block = source->read(qMin(remaining, fallbackBlockSize));
+        if (block.isEmpty()) {
+            sink->abort();
+            complete();
+            return;
+        }
+        offset += block.size();
+        remaining -= block.size();
+        sink->write(block);
+    }
+
+    void complete()
+    {
+        QObject::disconnect(bytesWrittenConnection);
+        QIODevice *device = owner.data();
+        if (!handler.isNull())
+            handler->completeWriting();
+        device->deleteLater();
+    }
+};
+#endif // Q_OS_LINUX
+
 QHttpServerHttp1ProtocolHandler::QHttpServerHttp1ProtocolHandler(QAbstractHttpServer *server,
                                                                  QIODevice *socket,
-                                                                 QHttpServerRequestFilter *filter)
-    : QHttpServerStream(server),
+                                                                 QHttpServerRequestFilter *filter,
+                                                                 QObject *parent)
+    : QHttpServerStream(parent),
       server(server),
       socket(socket),
       tcpSocket(qobject_cast<QTcpSocket *>(socket)),
@@ -269,9 +432,22 @@ QHttpServerHttp1ProtocolHandler::QHttpServerHttp1ProtocolHandler(QAbstractHttpSe
       localSocket(qobject_cast<QLocalSocket*>(socket)),
 #endif
       m_filter(filter),
-      request(initRequestFromSocket(tcpSocket))
+      request(new QHttpServerRequest(initRequestFromSocket(tcpSocket)))
 {
     socket->setParent(this);
+#if QT_CONFIG(ssl)
+    canWriteVectored = tcpSocket && !qobject_cast<QSslSocket *>(tcpSocket);
+#else
+    canWriteVectored = tcpSocket;
+#endif
+
+    if (canWriteVectored) {
+        // A shared body continues once the data buffered before it is written
+        connect(socket, &QIODevice::bytesWritten, this, [this] {
+            if (sharedWriteOwner)
+                writeSharedWrites();
+        });
+    }
 
     if (tcpSocket) {
         qCDebug(lcHttpServerHttp1Handler) << "Connection from:" << tcpSocket->peerAddress();
@@ -290,84 +466,234 @@ QHttpServerHttp1ProtocolHandler::QHttpServerHttp1ProtocolHandler(QAbstractHttpSe
     }
 }
 
-void QHttpServerHttp1ProtocolHandler::responderDestroyed()
+void QHttpServerHttp1ProtocolHandler::responderDestroyed(quint32 streamId)
 {
     Q_ASSERT(QThread::currentThread() == thread());
     if (protocolChanged) {
         deleteLater();
         return;
     }
-    Q_ASSERT(handlingRequest);
-    handlingRequest = false;
-    if (state == TransferState::Ready)
-        resumeListening();
+    Q_ASSERT(liveResponders > 0);
+    --liveResponders;
+    Exchange *exchange = findExchange(streamId);
+    Q_ASSERT(exchange);
+    exchange->responderAlive = false;
+    if (exchange->request->d->isStreamingBody())
+        exchange->request->d->streamingBody->discard(); // nobody reads the rest of the body
+    writeNextResponses();
+    if (liveResponders == 0 && state == TransferState::Ready && !isConnected())
+        deleteLater();
 }
 
+/*!
+    \internal
+
+    Reads the requests that were left in the socket while reading was
+    paused.
+*/
 void QHttpServerHttp1ProtocolHandler::resumeListening()
 {
-    if (tcpSocket) {
-        if (tcpSocket->state() != QAbstractSocket::ConnectedState) {
-            deleteLater();
-        } else {
-            connect(tcpSocket, &QTcpSocket::readyRead,
-                    this, &QHttpServerHttp1ProtocolHandler::handleReadyRead);
-            QMetaObject::invokeMethod(tcpSocket, &QTcpSocket::readyRead, Qt::QueuedConnection);
-        }
-#if QT_CONFIG(localserver)
-    } else if (localSocket) {
-        if (localSocket->state() != QLocalSocket::ConnectedState) {
-            deleteLater();
-        } else {
-            connect(localSocket, &QLocalSocket::readyRead,
-                    this, &QHttpServerHttp1ProtocolHandler::handleReadyRead);
-            QMetaObject::invokeMethod(localSocket, &QLocalSocket::readyRead, Qt::QueuedConnection);
-        }
-#endif
-    }
+    if (!std::exchange(readingPaused, false) || !isConnected())
+        return;
+    QMetaObject::invokeMethod(socket, &QIODevice::readyRead, Qt::QueuedConnection);
 }
 
 void QHttpServerHttp1ProtocolHandler::startHandlingRequest()
 {
-    handlingRequest = true;
+    ++liveResponders;
 }
 
 void QHttpServerHttp1ProtocolHandler::socketDisconnected()
 {
-    if (!handlingRequest)
+    if (streamingRequest) {
+        streamingRequest->d->streamingBody->abort();
+        streamingRequest = nullptr;
+    }
+    if (sharedWriteOwner) {
+        // The descriptor is gone, nothing more can be written
+        delete std::exchange(writeNotifier, nullptr);
+        pendingWrites.clear();
+        sharedWriteOffset = 0;
+        sharedWriteOwner.reset();
+        state = TransferState::Ready;
+    }
+    if (liveResponders == 0)
         deleteLater();
 }
 
-void QHttpServerHttp1ProtocolHandler::handleReadyRead()
+bool QHttpServerHttp1ProtocolHandler::isConnected() const
 {
-    if (handlingRequest || state != TransferState::Ready)
-        return;
-
-    if (!socket->isTransactionStarted())
-        socket->startTransaction();
+    if (tcpSocket)
+        return tcpSocket->state() == QAbstractSocket::ConnectedState;
+#if QT_CONFIG(localserver)
+    if (localSocket)
+        return localSocket->state() == QLocalSocket::ConnectedState;
+#endif
+    return false;
+}
 
-    if (!request.d->parse(socket)) {
-        if (tcpSocket)
-            tcpSocket->disconnectFromHost();
+void QHttpServerHttp1ProtocolHandler::closeConnection()
+{
+    if (tcpSocket)
+        tcpSocket->disconnectFromHost();
 #if QT_CONFIG(localserver)
-        else if (localSocket)
-            localSocket->disconnectFromServer();
+    else if (localSocket)
+        localSocket->disconnectFromServer();
 #endif
+}
+
+/*!
+    \internal
+
+    Answers a request that exceeds one of the configured limits with
+    \a status and closes the connection, since the rest of the request is
+    not read.
+*/
+void QHttpServerHttp1ProtocolHandler::rejectRequest(QHttpServerResponder::StatusCode status)
+{
+    qCDebug(lcHttpServerHttp1Handler) << "Request rejected with" << status;
+    QHttpHeaders headers;
+    headers.append(QHttpHeaders::WellKnownHeader::ContentType,
+                   QHttpServerLiterals::contentTypeXEmpty());
+    headers.append(QHttpHeaders::WellKnownHeader::ContentLength, "0");
+    headers.append(QHttpHeaders::WellKnownHeader::Connection, "close");
+    writeStatusAndHeaders(status, headers);
+    flushWrites();
+    closeConnection();
+}
+
+/*!
+    \internal
+
+    Stops reading from the connection, which cannot be parsed any further.
+    Once the responses to the earlier requests are written, the connection
+    is closed, after answering with \a status if there is one.
+*/
+void QHttpServerHttp1ProtocolHandler::stopReading(
+        std::optional<QHttpServerResponder::StatusCode> status)
+{
+    readingStopped = true;
+    auto close = [this, status] {
+        if (status)
+            rejectRequest(*status);
+        else
+            closeConnection();
+    };
+    if (exchanges.empty()) {
+        close();
         return;
     }
+    Exchange exchange{ nextExchangeId++, nullptr, false, useHttp1_1, {} };
+    exchange.deferredWrites.emplace_back(std::move(close));
+    exchanges.push_back(std::move(exchange));
+}
+
+void QHttpServerHttp1ProtocolHandler::setReadBufferSize(qint64 size)
+{
+    if (tcpSocket)
+        tcpSocket->setReadBufferSize(size);
+#if QT_CONFIG(localserver)
+    else if (localSocket)
+        localSocket->setReadBufferSize(size);
+#endif
+}
+
+void QHttpServerHttp1ProtocolHandler::handleReadyRead()
+{
+    if (streamingRequest) {
+        readStreamingBody();
+        if (streamingRequest)
+            return;
+    }
+
+    using State = QHttpServerRequestPrivate::State;
+    // Every complete request in the buffer is handled right away, also while
+    // the responses to earlier requests are still to be written
+    while (!readingStopped && !protocolChanged) {
+        if (qsizetype(exchanges.size()) >= MaxPipelinedRequests) {
+            readingPaused = true;
+            return;
+        }
+
+        // A request that is parsed already waits for the earlier responses
+        if (request->d->state != State::AllDone) {
+            const bool readingHead = request->d->state < State::ReadingData;
+            // The header block is kept to be handed over in case of a WebSocket upgrade
+            if (readingHead && !socket->isTransactionStarted())
+                socket->startTransaction();
+
+            request->d->setLimits(configuration(m_filter));
+            // An interim response must not end up in the middle of an earlier response
+            request->d->deferContinue = !exchanges.empty();
+            if (!request->d->parse(socket)) {
+                stopReading(request->d->limitExceeded);
+                return;
+            }
+
+            if (request->d->state == State::ReadingData && !request->d->upgrade
+                && socket->isTransactionStarted()) {
+                // Do not keep a copy of the body in the socket
+                socket->commitTransaction();
+            }
+
+            if (request->d->state == State::ExpectContinue) {
+                readingPaused = true;
+                return;
+            }
+
+            if (request->d->state != State::AllDone) {
+                // Once the headers are complete, a streaming route is called right away
+                if (!readingHead || request->d->state != State::ReadingData
+                    || request->d->upgrade || !server->d_func()->streamsRequestBody(*request)) {
+                    return; // Partial read
+                }
+                request->d->startStreamingBody();
+                connect(request->d->streamingBody.get(), &QHttpServerRequestBodyDevice::drained,
+                        this, &QHttpServerHttp1ProtocolHandler::handleReadyRead,
+                        Qt::QueuedConnection);
+                setReadBufferSize(StreamingReadBufferSize);
+                streamingRequest = request.get();
+            }
+        }
+
+        // The connection may change hands, so nothing else can be pending
+        if (request->d->upgrade && !exchanges.empty()) {
+            readingPaused = true;
+            return;
+        }
+
+        handleRequest();
+        if (streamingRequest)
+            return; // The rest of the body is read while the handler runs
+    }
+}
+
+/*!
+    \internal
 
-    if (request.d->state != QHttpServerRequestPrivate::State::AllDone)
-        return; // Partial read
+    Calls the handler of the request that was parsed last. Its response is
+    written once the responses to the requests before it are.
+*/
+void QHttpServerHttp1ProtocolHandler::handleRequest()
+{
+    const quint32 id = nextExchangeId++;
+    QHttpServerRequest &current = *request;
+    exchanges.push_back({ id, std::move(request), true, current.d->minorVersion == 1, {} });
+    request = takeRequest();
+    if (exchanges.size() == 1)
+        useHttp1_1 = exchanges.front().useHttp1_1;
 
-    qCDebug(lcHttpServerHttp1Handler) << "Request:" << request;
-    useHttp1_1 = request.d->minorVersion == 1;
+    qCDebug(lcHttpServerHttp1Handler) << "Request:" << current;
 
     QHttpServerResponder responder(this);
+    responder.d_ptr->m_streamId = id;
+    responder.d_ptr->prepare(current, configuration(m_filter));
 
     if (auto *tcpSocket = qobject_cast<QTcpSocket*>(socket)) {
-        if (request.d->upgrade) { // Upgrade
-            const auto &upgradeValue = request.value(QByteArrayLiteral("upgrade"));
+        if (current.d->upgrade) { // Upgrade
+            const auto &upgradeValue = current.value(QByteArrayLiteral("upgrade"));
             if (upgradeValue.compare(QByteArrayLiteral("websocket"), Qt::CaseInsensitive) == 0) {
-                const auto upgradeResponse = server->verifyWebSocketUpgrade(request);
+                const auto upgradeResponse = server->verifyWebSocketUpgrade(current);
                 static const auto signal =
                         QMetaMethod::fromSignal(&QAbstractHttpServer::newWebSocketConnection);
                 if (server->isSignalConnected(signal)
@@ -380,8 +706,17 @@ void QHttpServerHttp1ProtocolHandler::handleReadyRead()
                         socket->disconnect();
                         socket->rollbackTransaction();
                         socket->setParent(nullptr);
-                        server->d_func()->websocketServer.handleConnection(tcpSocket);
-                        Q_EMIT socket->readyRead();
+                        if (server->thread() == thread()) {
+                            server->d_func()->websocketServer.handleConnection(tcpSocket);
+                            Q_EMIT socket->readyRead();
+                        } else {
+                            // The WebSocket server lives in the thread of the HTTP server
+                            tcpSocket->moveToThread(server->thread());
+                            QMetaObject::invokeMethod(server, [server = server, tcpSocket] {
+                                server->d_func()->websocketServer.handleConnection(tcpSocket);
+                                Q_EMIT tcpSocket->readyRead();
+                            }, Qt::QueuedConnection);
+                        }
                     } else {
                         qCDebug(lcHttpServerHttp1Handler, "WebSocket upgrade denied: %ls",
                                 qUtf16Printable(QLatin1StringView(upgradeResponse.denyMessage())));
@@ -399,7 +734,7 @@ void QHttpServerHttp1ProtocolHandler::handleReadyRead()
                                   "WebSocket received but no slots connected to "
                                   "QWebSocketServer::newConnection");
                     }
-                    server->missingHandler(request, responder);
+                    server->missingHandler(current, responder);
                     tcpSocket->disconnectFromHost();
                 }
                 return;
@@ -407,49 +742,230 @@ void QHttpServerHttp1ProtocolHandler::handleReadyRead()
         }
     }
 
-    socket->commitTransaction();
+    if (socket->isTransactionStarted())
+        socket->commitTransaction();
 
     QHostAddress peerAddress = tcpSocket ? tcpSocket->peerAddress()
                                          : QHostAddress::LocalHost;
     if (!m_filter->isRequestWithinRate(peerAddress)) {
         responder.sendResponse(
                 QHttpServerResponse(QHttpServerResponder::StatusCode::TooManyRequests));
-    } else if (!server->handleRequest(request, responder)) {
-        server->missingHandler(request, responder);
+    } else if (!server->handleRequest(current, responder)) {
+        server->missingHandler(current, responder);
+    }
+}
+
+/*!
+    \internal
+
+    Reads more of the body of a streaming request. The requests after it
+    are read once the body is complete.
+*/
+void QHttpServerHttp1ProtocolHandler::readStreamingBody()
+{
+    if (!streamingRequest->d->parse(socket)) {
+        // The handler may be responding already, so there is no room for an error
+        streamingRequest->d->streamingBody->abort();
+        streamingRequest = nullptr;
+        stopReading(std::nullopt);
+        return;
+    }
+
+    if (streamingRequest->d->state != QHttpServerRequestPrivate::State::AllDone)
+        return; // Partial read, or the handler has to catch up
+
+    streamingRequest = nullptr;
+    setReadBufferSize(0);
+    writeNextResponses();
+}
+
+/*!
+    \internal
+
+    Returns an empty request to parse the next one into.
+*/
+std::unique_ptr<QHttpServerRequest> QHttpServerHttp1ProtocolHandler::takeRequest()
+{
+    if (spareRequest)
+        return std::move(spareRequest);
+    return std::unique_ptr<QHttpServerRequest>(
+            new QHttpServerRequest(initRequestFromSocket(tcpSocket)));
+}
+
+QHttpServerHttp1ProtocolHandler::Exchange *
+QHttpServerHttp1ProtocolHandler::findExchange(quint32 streamId)
+{
+    const auto it = std::find_if(exchanges.begin(), exchanges.end(),
+                                 [streamId](const Exchange &exchange) {
+                                     return exchange.id == streamId;
+                                 });
+    return it != exchanges.end() ? &*it : nullptr;
+}
+
+/*!
+    \internal
+
+    Drops the exchanges at the front of the queue whose responses are
+    written completely, and writes the responses that waited for them.
+*/
+void QHttpServerHttp1ProtocolHandler::writeNextResponses()
+{
+    if (writingResponses)
+        return; // The loop below continues
+    QScopedValueRollback writingGuard(writingResponses, true);
+
+    bool finishedAny = false;
+    while (!exchanges.empty() && state == TransferState::Ready) {
+        Exchange &first = exchanges.front();
+        if (first.responderAlive || (first.request && first.request->d->isStreamingBody()))
+            break;
+        if (first.request && !spareRequest) {
+            first.request->d->clear();
+            first.request->d->state = QHttpServerRequestPrivate::State::NothingDone;
+            spareRequest = std::move(first.request);
+        }
+        exchanges.pop_front();
+        finishedAny = true;
+
+        if (exchanges.empty())
+            break;
+        Exchange &next = exchanges.front();
+        useHttp1_1 = next.useHttp1_1;
+        const auto writes = std::exchange(next.deferredWrites, {});
+        for (const auto &deferredWrite : writes)
+            deferredWrite();
     }
 
-    if (handlingRequest || state != TransferState::Ready)
-        disconnect(socket, &QIODevice::readyRead, this, &QHttpServerHttp1ProtocolHandler::handleReadyRead);
-    else if (socket->bytesAvailable() > 0)
-        QMetaObject::invokeMethod(socket, &QIODevice::readyRead, Qt::QueuedConnection);
+    if (finishedAny)
+        resumeListening();
 }
 
 void QHttpServerHttp1ProtocolHandler::write(const QByteArray &body, const QHttpHeaders &headers,
                                         QHttpServerResponder::StatusCode status, quint32 streamId)
 {
-    Q_UNUSED(streamId);
+    if (deferWrite(streamId, [this, body, headers, status, streamId] {
+            write(body, headers, status, streamId);
+        })) {
+        return;
+    }
     Q_ASSERT(state == TransferState::Ready);
     writeStatusAndHeaders(status, headers);
-    write(body);
+    queueWrite(body);
+    flushWrites();
     state = TransferState::Ready;
 }
 
+/*!
+    \internal
+
+    Writes \a body, whose memory \a bodyOwner keeps alive, e.g. a mapped
+    file. On a plain TCP socket, the body is written from that memory to the
+    socket descriptor, however long that takes, so it is never copied into
+    the write buffer of the socket.
+*/
+void QHttpServerHttp1ProtocolHandler::writeSharedBody(const QByteArray &body,
+                                                      const std::shared_ptr<const void> &bodyOwner,
+                                                      const QHttpHeaders &headers,
+                                                      QHttpServerResponder::StatusCode status,
+                                                      quint32 streamId)
+{
+    if (deferWrite(streamId, [this, body, bodyOwner, headers, status, streamId] {
+            writeSharedBody(body, bodyOwner, headers, status, streamId);
+        })) {
+        return;
+    }
+#if defined(Q_OS_UNIX)
+    if (canWriteVectored && bodyOwner) {
+        Q_ASSERT(state == TransferState::Ready);
+        writeStatusAndHeaders(status, headers);
+        queueWrite(body);
+        state = TransferState::IODeviceTransferBegun;
+        sharedWriteOwner = bodyOwner;
+        sharedWriteOffset = 0;
+        writeSharedWrites();
+        return;
+    }
+#endif
+    write(body, headers, status, streamId);
+}
+
+/*!
+    \internal
+
+    Writes as much of the queued response with a shared body as the socket
+    descriptor takes, and waits for it to become writable again for the
+    rest. Writing is complete when all of it is written.
+*/
+void QHttpServerHttp1ProtocolHandler::writeSharedWrites()
+{
+    Q_ASSERT(QThread::currentThread() == thread());
+    if (writeNotifier)
+        writeNotifier->setEnabled(false);
+
+    while (!pendingWrites.isEmpty()) {
+        // Keep the order of the data buffered in the socket, bytesWritten
+        // continues once it is written
+        if (socket->bytesToWrite() > 0)
+            return;
+
+        qint64 written = writeVectored(sharedWriteOffset);
+        if (written < 0) {
+            // The socket reports the error when writing the data itself
+            for (const QByteArray &data : std::as_const(pendingWrites)) {
+                socket->write(data.constData() + sharedWriteOffset,
+                              data.size() - sharedWriteOffset);
+                sharedWriteOffset = 0;
+            }
+            pendingWrites.clear();
+            break;
+        }
+        if (written == 0) {
+            if (!writeNotifier) {
+                writeNotifier = new QSocketNotifier(tcpSocket->socketDescriptor(),
+                                                    QSocketNotifier::Write, this);
+                connect(writeNotifier, &QSocketNotifier::activated,
+                        this, &QHttpServerHttp1ProtocolHandler::writeSharedWrites);
+            }
+            writeNotifier->setEnabled(true);
+            return;
+        }
+
+        written += sharedWriteOffset;
+        qsizetype done = 0;
+        while (done < pendingWrites.size() && written >= pendingWrites[done].size())
+            written -= pendingWrites[done++].size();
+        pendingWrites.remove(0, done);
+        sharedWriteOffset = qsizetype(written);
+    }
+
+    sharedWriteOffset = 0;
+    sharedWriteOwner.reset();
+    completeWriting();
+}
+
 void QHttpServerHttp1ProtocolHandler::write(QHttpServerResponder::StatusCode status, quint32 streamId)
 {
-    Q_UNUSED(streamId);
+    if (deferWrite(streamId, [this, status, streamId] { write(status, streamId); }))
+        return;
     Q_ASSERT(state == TransferState::Ready);
     QHttpHeaders headers;
     headers.append(QHttpHeaders::WellKnownHeader::ContentType,
                    QHttpServerLiterals::contentTypeXEmpty());
     headers.append(QHttpHeaders::WellKnownHeader::ContentLength, "0");
     writeStatusAndHeaders(status, headers);
+    flushWrites();
     state = TransferState::Ready;
 }
 
 void QHttpServerHttp1ProtocolHandler::write(QIODevice *data, const QHttpHeaders &headers,
                                         QHttpServerResponder::StatusCode status, quint32 streamId)
 {
-    Q_UNUSED(streamId);
+    if (deferWrite(streamId, [this, data, headers, status, streamId] {
+            write(data, headers, status, streamId);
+        })) {
+        data->setParent(this); // Deleted with the connection if it is never written
+        return;
+    }
     Q_ASSERT(state == TransferState::Ready);
     std::unique_ptr<QIODevice, QScopedPointerDeleteLater> input(data);
 
@@ -459,14 +975,14 @@ void QHttpServerHttp1ProtocolHandler::write(QIODevice *data, const QHttpHeaders
             // TODO Add developer error handling
             qCDebug(lcHttpServerHttp1Handler, "500: Could not open device %ls",
                     qUtf16Printable(input->errorString()));
-            write(QHttpServerResponder::StatusCode::InternalServerError, 0);
+            write(QHttpServerResponder::StatusCode::InternalServerError, streamId);
             return;
         }
     } else if (!(input->openMode() & QIODevice::ReadOnly)) {
         // TODO Add developer error handling
         qCDebug(lcHttpServerHttp1Handler) << "500: Device is opened in a wrong mode"
                                           << input->openMode();
-        write(QHttpServerResponder::StatusCode::InternalServerError, 0);
+        write(QHttpServerResponder::StatusCode::InternalServerError, streamId);
         return;
     }
 
@@ -481,8 +997,28 @@ void QHttpServerHttp1ProtocolHandler::write(QIODevice *data, const QHttpHeaders
                           QByteArray::number(input->size()));
     }
     writeStatusAndHeaders(status, allHeaders);
+    flushWrites();
 
     state = TransferState::IODeviceTransferBegun;
+#if defined(Q_OS_LINUX)
+    // TLS and local sockets need the data in user space
+    auto *file = qobject_cast<QFile *>(input.get());
+    qint64 offset = file ? file->pos() : 0;
+    qint64 length = file ? file->size() - offset : 0;
+    // A single range of a file is sent from the file directly
+    if (auto *ranges = qobject_cast<QHttpServerRangeDevice *>(input.get());
+        ranges && !ranges->isMultipart()) {
+        file = qobject_cast<QFile *>(ranges->source());
+        offset = ranges->ranges().first().first;
+        length = ranges->size();
+    }
+    if (canWriteVectored && file && !file->isSequential() && file->handle() != -1) {
+        // file takes ownership of the QHttpServerHttp1SendFileTransfer pointer
+        new QHttpServerHttp1SendFileTransfer(file, offset, length, input.release(), tcpSocket,
+                                             this);
+        return;
+    }
+#endif
     // input takes ownership of the QHttpServerHttp1IOChunkedTransfer pointer inside his constructor
     new QHttpServerHttp1IOChunkedTransfer<>(input.release(), socket, useHttp1_1, this);
 }
@@ -491,44 +1027,59 @@ void QHttpServerHttp1ProtocolHandler::writeBeginChunked(const QHttpHeaders &head
                                                     QHttpServerResponder::StatusCode status,
                                                     quint32 streamId)
 {
-    Q_UNUSED(streamId);
+    if (deferWrite(streamId, [this, headers, status, streamId] {
+            writeBeginChunked(headers, status, streamId);
+        })) {
+        return;
+    }
     Q_ASSERT(state == TransferState::Ready);
     QHttpHeaders allHeaders(headers);
     allHeaders.append(QHttpHeaders::WellKnownHeader::TransferEncoding, "chunked");
     writeStatusAndHeaders(status, allHeaders);
+    flushWrites();
     state = TransferState::ChunkedTransferBegun;
 }
 
 void QHttpServerHttp1ProtocolHandler::writeChunk(const QByteArray &data, quint32 streamId)
 {
-    Q_UNUSED(streamId);
+    if (deferWrite(streamId, [this, data, streamId] { writeChunk(data, streamId); }))
+        return;
     Q_ASSERT(state == TransferState::ChunkedTransferBegun);
+    queueChunk(data);
+    flushWrites();
+}
 
+void QHttpServerHttp1ProtocolHandler::queueChunk(const QByteArray &data)
+{
     if (data.length() == 0) {
         qCWarning(lcHttpServerHttp1Handler, "Chunk must have length > 0");
         return;
     }
 
-    write(QByteArray::number(data.length(), 16));
-    write("\r\n");
-    write(data);
-    write("\r\n");
+    queueWrite(QByteArray::number(data.length(), 16) + "\r\n");
+    queueWrite(data);
+    queueWrite(QByteArrayLiteral("\r\n"));
 }
 
 void QHttpServerHttp1ProtocolHandler::writeEndChunked(const QByteArray &data,
                                                       const QHttpHeaders &trailers,
                                                       quint32 streamId)
 {
-    Q_UNUSED(streamId);
+    if (deferWrite(streamId, [this, data, trailers, streamId] {
+            writeEndChunked(data, trailers, streamId);
+        })) {
+        return;
+    }
     Q_ASSERT(state == TransferState::ChunkedTransferBegun);
-    writeChunk(data, 0);
-    write("0\r\n");
+    queueChunk(data);
+    queueWrite(QByteArrayLiteral("0\r\n"));
     for (qsizetype i = 0; i < trailers.size(); ++i) {
         const auto name = trailers.nameAt(i);
         const auto value = trailers.valueAt(i);
         writeHeader({ name.data(), name.size() }, value.toByteArray());
     }
-    write("\r\n");
+    queueWrite(QByteArrayLiteral("\r\n"));
+    flushWrites();
     state = TransferState::Ready;
 }
 
@@ -536,49 +1087,164 @@ void QHttpServerHttp1ProtocolHandler::writeStatusAndHeaders(QHttpServerResponder
                                                         const QHttpHeaders &headers)
 {
     Q_ASSERT(state == TransferState::Ready);
-    QByteArray payload;
-    payload.append("HTTP/1.1 ");
-    payload.append(QByteArray::number(quint32(status)));
-    const auto it = statusString.find(status);
-    if (it != statusString.end()) {
-        payload.append(" ");
-        payload.append(statusString.at(status));
+    const int code = int(status);
+    QByteArray unknownStatusLine;
+    QByteArrayView statusLine;
+    if (code >= FirstStatusCode && code <= LastStatusCode)
+        statusLine = statusLineTable[code - FirstStatusCode];
+    if (statusLine.isEmpty()) {
+        unknownStatusLine = "HTTP/1.1 " + QByteArray::number(code) + "\r\n";
+        statusLine = unknownStatusLine;
     }
-    payload.append("\r\n");
 
+    const QHttpServerConfiguration &config = configuration(m_filter);
+    QByteArrayView date;
+    if (config.isDateHeaderEnabled() && !headers.contains(QHttpHeaders::WellKnownHeader::Date))
+        date = httpDate();
+    QByteArray serverName;
+    if (!headers.contains(QHttpHeaders::WellKnownHeader::Server))
+        serverName = config.serverHeader();
+
+    qsizetype size = statusLine.size() + 2;
+    if (!date.isEmpty())
+        size += 6 + date.size() + 2;
+    if (!serverName.isEmpty())
+        size += 8 + serverName.size() + 2;
+    for (qsizetype i = 0; i < headers.size(); ++i)
+        size += headers.nameAt(i).size() + 2 + headers.valueAt(i).size() + 2;
+
+    QByteArray payload(size, Qt::Uninitialized);
+    char *out = payload.data();
+    const auto append = [&out](QByteArrayView data) {
+        // An empty view may have no data, which memcpy() must not get
+        if (data.isEmpty())
+            return;
+        memcpy(out, data.data(), data.size());
+        out += data.size();
+    };
+    append(statusLine);
+    if (!date.isEmpty()) {
+        append("Date: ");
+        append(date);
+        append("\r\n");
+    }
+    if (!serverName.isEmpty()) {
+        append("Server: ");
+        append(serverName);
+        append("\r\n");
+    }
     for (qsizetype i = 0; i < headers.size(); ++i) {
-        const auto name = headers.nameAt(i);
-        payload.append(QByteArrayView(name.data(), name.size()) + ": "
-                       + headers.valueAt(i).toByteArray() + "\r\n");
+        const QLatin1StringView name = headers.nameAt(i);
+        append(QByteArrayView(name.data(), name.size()));
+        append(": ");
+        append(headers.valueAt(i));
+        append("\r\n");
     }
-    payload.append("\r\n");
-    write(payload);
+    append("\r\n");
+    Q_ASSERT(out == payload.constData() + payload.size());
+    queueWrite(payload);
     state = TransferState::HeadersSent;
 }
 
 void QHttpServerHttp1ProtocolHandler::writeHeader(const QByteArray &key, const QByteArray &value)
 {
-    write(key + ": " + value + "\r\n");
+    queueWrite(key + ": " + value + "\r\n");
 }
 
-void QHttpServerHttp1ProtocolHandler::write(const QByteArray &ba)
+/*!
+    \internal
+
+    Queues \a data to be written by the next flushWrites(). The data is
+    shared, not copied.
+*/
+void QHttpServerHttp1ProtocolHandler::queueWrite(const QByteArray &data)
 {
-    Q_ASSERT(QThread::currentThread() == thread());
-    socket->write(ba);
+    if (!data.isEmpty())
+        pendingWrites.append(data);
 }
 
-void QHttpServerHttp1ProtocolHandler::write(const char *body, qint64 size)
+/*!
+    \internal
+
+    Writes the queued data to the socket. On a plain TCP socket with nothing
+    buffered, as much as the kernel takes is written directly to the socket
+    descriptor with a single sendmsg() call. Only the rest is copied into
+    the write buffer of the socket.
+*/
+void QHttpServerHttp1ProtocolHandler::flushWrites()
 {
     Q_ASSERT(QThread::currentThread() == thread());
-    socket->write(body, size);
+    if (pendingWrites.isEmpty())
+        return;
+
+    qint64 written = qMax(writeVectored(), qint64(0));
+    for (const QByteArray &data : std::as_const(pendingWrites)) {
+        if (written >= data.size()) {
+            written -= data.size();
+            continue;
+        }
+        socket->write(data.constData() + written, data.size() - written);
+        written = 0;
+    }
+    pendingWrites.clear();
+}
+
+/*!
+    \internal
+
+    Writes as much of the queued data as possible to the socket descriptor,
+    starting \a firstOffset bytes into the first piece, and returns the
+    number of bytes written. Returns 0 if the data has to go through the
+    socket, e.g. because of TLS or data that is already buffered, or if the
+    descriptor takes no more data at the moment, and -1 on other errors.
+*/
+qint64 QHttpServerHttp1ProtocolHandler::writeVectored(qsizetype firstOffset)
+{
+#if defined(Q_OS_UNIX)
+    if (!canWriteVectored || socket->bytesToWrite() > 0
+        || tcpSocket->state() != QAbstractSocket::ConnectedState) {
+        return 0;
+    }
+    const qintptr descriptor = tcpSocket->socketDescriptor();
+    if (descriptor == -1)
+        return 0;
+
+    constexpr qsizetype MaxVectors = 16;
+    iovec vectors[MaxVectors];
+    const qsizetype count = qMin(pendingWrites.size(), MaxVectors);
+    for (qsizetype i = 0; i < count; ++i) {
+        const qsizetype offset = i == 0 ? firstOffset : 0;
+        vectors[i].iov_base = const_cast<char *>(pendingWrites[i].constData() + offset);
+        vectors[i].iov_len = size_t(pendingWrites[i].size() - offset);
+    }
+
+    msghdr message = {};
+    message.msg_iov = vectors;
+    message.msg_iovlen = decltype(message.msg_iovlen)(count);
+#if defined(MSG_NOSIGNAL)
+    constexpr int flags = MSG_NOSIGNAL;
+#else
+    constexpr int flags = 0; // Qt sets SO_NOSIGPIPE where there is no MSG_NOSIGNAL
+#endif
+
+    ssize_t result;
+    do {
+        result = ::sendmsg(int(descriptor), &message, flags);
+    } while (result == -1 && errno == EINTR);
+    if (result == -1 && errno != EAGAIN && errno != EWOULDBLOCK)
+        return -1;
+    return result > 0 ? qint64(result) : 0;
+#else
+    Q_UNUSED(firstOffset);
+    return 0;
+#endif
 }
 
 void QHttpServerHttp1ProtocolHandler::completeWriting()
 {
     Q_ASSERT(state == TransferState::IODeviceTransferBegun);
     state = TransferState::Ready;
-    if (!handlingRequest)
-        resumeListening();
+    writeNextResponses();
 }
 
 QT_END_NAMESPACE
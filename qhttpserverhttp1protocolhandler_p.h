@@ -9,6 +9,14 @@
 #include "qhttpserverstream_p.h"
 #include "qhttpserverrequestfilter_p.h"
 
+#include <QtCore/qvarlengtharray.h>
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <vector>
+
 //
 //  W A R N I N G
 //  -------------
@@ -21,6 +29,7 @@
 
 QT_BEGIN_NAMESPACE
 
+class QSocketNotifier;
 class QTcpSocket;
 class QAbstractHttpServer;
 #if QT_CONFIG(localserver)
@@ -39,16 +48,28 @@ class QHttpServerHttp1ProtocolHandler : public QHttpServerStream
 private:
     QHttpServerHttp1ProtocolHandler(QAbstractHttpServer *server,
                                     QIODevice *socket,
-                                    QHttpServerRequestFilter *filter);
+                                    QHttpServerRequestFilter *filter,
+                                    QObject *parent);
 
-    void responderDestroyed() final;
+    void responderDestroyed(quint32 streamId) final;
     void startHandlingRequest() final;
     void socketDisconnected() final;
 
     void handleReadyRead();
+    void handleRequest();
+    void readStreamingBody();
+    void stopReading(std::optional<QHttpServerResponder::StatusCode> status);
+    bool isConnected() const;
+    void closeConnection();
+    void rejectRequest(QHttpServerResponder::StatusCode status);
+    void setReadBufferSize(qint64 size);
+    std::unique_ptr<QHttpServerRequest> takeRequest();
 
     void write(const QByteArray &body, const QHttpHeaders &headers,
                QHttpServerResponder::StatusCode status, quint32 streamId) final;
+    void writeSharedBody(const QByteArray &body, const std::shared_ptr<const void> &bodyOwner,
+                         const QHttpHeaders &headers, QHttpServerResponder::StatusCode status,
+                         quint32 streamId) final;
     void write(QHttpServerResponder::StatusCode status, quint32 streamId) final;
     void write(QIODevice *data, const QHttpHeaders &headers,
                QHttpServerResponder::StatusCode status, quint32 streamId) final;
@@ -63,9 +84,13 @@ private:
     void writeStatusAndHeaders(QHttpServerResponder::StatusCode status,
                                const QHttpHeaders &headers);
     void writeHeader(const QByteArray &key, const QByteArray &value);
-    void write(const QByteArray &data);
-    void write(const char *body, qint64 size);
+    void queueChunk(const QByteArray &data);
+    void queueWrite(const QByteArray &data);
+    void flushWrites();
+    qint64 writeVectored(qsizetype firstOffset = 0);
+    void writeSharedWrites();
 
+    void writeNextResponses();
     void resumeListening();
 
     QAbstractHttpServer *server;
@@ -76,6 +101,16 @@ private:
 #endif
     QHttpServerRequestFilter *m_filter;
 
+    // Parts of the response written to the socket at once by flushWrites()
+    QVarLengthArray<QByteArray, 8> pendingWrites;
+    // Whether the socket descriptor can be written to directly
+    bool canWriteVectored = false;
+    // Keeps the memory of a shared body alive while writeSharedWrites()
+    // writes pendingWrites, from sharedWriteOffset on, to the descriptor
+    std::shared_ptr<const void> sharedWriteOwner;
+    qsizetype sharedWriteOffset = 0;
+    QSocketNotifier *writeNotifier = nullptr;
+
     enum class TransferState {
         Ready,
         HeadersSent,
@@ -83,17 +118,55 @@ private:
         IODeviceTransferBegun,
     } state = TransferState::Ready;
 
-    QHttpServerRequest request;
+    // The request being parsed. It is on the heap, because handlers keep
+    // referring to it until they respond.
+    std::unique_ptr<QHttpServerRequest> request;
+    // A finished request kept for reuse
+    std::unique_ptr<QHttpServerRequest> spareRequest;
+    // The request whose body is read while its handler runs
+    QHttpServerRequest *streamingRequest = nullptr;
+
+    // A request that is handled, in the order in which the responses are
+    // written. Responses to all but the first one wait in deferredWrites.
+    struct Exchange
+    {
+        quint32 id;
+        std::unique_ptr<QHttpServerRequest> request;
+        bool responderAlive = true;
+        bool useHttp1_1 = false;
+        std::vector<std::function<void()>> deferredWrites;
+    };
+    std::deque<Exchange> exchanges;
+    quint32 nextExchangeId = 0;
+
+    Exchange *findExchange(quint32 streamId);
+    // Keeps write to be called once the earlier responses are written.
+    // Returns false if the response with streamId can be written right away.
+    template <typename Write>
+    bool deferWrite(quint32 streamId, Write &&write)
+    {
+        if (exchanges.empty() || exchanges.front().id == streamId)
+            return false;
+        Exchange *exchange = findExchange(streamId);
+        Q_ASSERT(exchange);
+        exchange->deferredWrites.emplace_back(std::forward<Write>(write));
+        return true;
+    }
 
    // To avoid destroying the object when socket object is destroyed while
    // a request is still being handled.
-    bool handlingRequest = false;
+    qsizetype liveResponders = 0;
+    // Whether reading has to be resumed once a response is written
+    bool readingPaused = false;
+    bool readingStopped = false;
+    bool writingResponses = false;
     bool protocolChanged = false;
     bool useHttp1_1 = false;
     void completeWriting();
 
     template <qint64 BUFFERSIZE>
     friend struct QHttpServerHttp1IOChunkedTransfer;
+    friend struct QHttpServerHttp1SendFileTransfer;
 };
 
 QT_END_NAMESPACE
@@ -29,12 +29,26 @@ void toHeaderPairs(HPack::HttpHeader &fields, const QHttpHeaders &headers)
     }
 }
 
+// Moves what was received of the body of stream to file
+bool moveDownloadBuffer(QHttp2Stream *stream, QIODevice *file)
+{
+    QByteDataBuffer buffer = stream->downloadBuffer();
+    stream->clearDownloadBuffer();
+    while (!buffer.isEmpty()) {
+        const QByteArray data = buffer.read();
+        if (file->write(data) != data.size())
+            return false;
+    }
+    return true;
+}
+
 } // anonymous namespace
 
 QHttpServerHttp2ProtocolHandler::QHttpServerHttp2ProtocolHandler(QAbstractHttpServer *server,
                                                                  QIODevice *socket,
-                                                                 QHttpServerRequestFilter *filter)
-    : QHttpServerStream(server),
+                                                                 QHttpServerRequestFilter *filter,
+                                                                 QObject *parent)
+    : QHttpServerStream(parent),
       m_server(server),
       m_socket(socket),
       m_tcpSocket(qobject_cast<QTcpSocket *>(socket)),
@@ -71,8 +85,9 @@ QHttpServerHttp2ProtocolHandler::QHttpServerHttp2ProtocolHandler(QAbstractHttpSe
             &QHttpServerHttp2ProtocolHandler::onStreamCreated);
 }
 
-void QHttpServerHttp2ProtocolHandler::responderDestroyed()
+void QHttpServerHttp2ProtocolHandler::responderDestroyed(quint32 streamId)
 {
+    Q_UNUSED(streamId);
     m_responderCounter--;
 }
 
@@ -90,6 +105,15 @@ void QHttpServerHttp2ProtocolHandler::socketDisconnected()
 void QHttpServerHttp2ProtocolHandler::write(const QByteArray &body, const QHttpHeaders &headers,
                                             QHttpServerResponder::StatusCode status,
                                             quint32 streamId)
+{
+    writeSharedBody(body, nullptr, headers, status, streamId);
+}
+
+void QHttpServerHttp2ProtocolHandler::writeSharedBody(const QByteArray &body,
+                                                      const std::shared_ptr<const void> &bodyOwner,
+                                                      const QHttpHeaders &headers,
+                                                      QHttpServerResponder::StatusCode status,
+                                                      quint32 streamId)
 {
     QHttp2Stream *stream = getStream(streamId);
     if (!stream)
@@ -100,6 +124,11 @@ void QHttpServerHttp2ProtocolHandler::write(const QByteArray &body, const QHttpH
     QBuffer *buffer = new QBuffer(stream);
     buffer->setData(body);
     buffer->open(QIODevice::ReadOnly);
+    if (bodyOwner) {
+        // The data is sent asynchronously, keep what it refers to until the
+        // buffer is gone
+        connect(buffer, &QObject::destroyed, buffer, [bodyOwner] {});
+    }
 
     connect(stream, &QHttp2Stream::uploadFinished, buffer, &QObject::deleteLater);
     stream->sendDATA(buffer, true);
@@ -152,7 +181,7 @@ void QHttpServerHttp2ProtocolHandler::write(QIODevice *data, const QHttpHeaders
                           QByteArray::number(data->size()));
     }
 
-    writeHeadersAndStatus(headers, status, false, streamId);
+    writeHeadersAndStatus(allHeaders, status, false, streamId);
 
     input->setParent(stream);
     connect(stream, &QHttp2Stream::uploadFinished, input.get(), &QObject::deleteLater);
@@ -210,6 +239,12 @@ void QHttpServerHttp2ProtocolHandler::writeHeadersAndStatus(const QHttpHeaders &
 
     HPack::HttpHeader h;
     h.push_back(HPack::HeaderField(":status", QByteArray::number(quint32(status))));
+    const QHttpServerConfiguration &config = configuration(m_filter);
+    if (config.isDateHeaderEnabled() && !headers.contains(QHttpHeaders::WellKnownHeader::Date))
+        h.push_back(HPack::HeaderField("date", httpDate().toByteArray()));
+    const QByteArray serverName = config.serverHeader();
+    if (!serverName.isEmpty() && !headers.contains(QHttpHeaders::WellKnownHeader::Server))
+        h.push_back(HPack::HeaderField("server", serverName));
     toHeaderPairs(h, headers);
     stream->sendHEADERS(h, endStream);
 }
@@ -252,6 +287,54 @@ void QHttpServerHttp2ProtocolHandler::onStreamCreated(QHttp2Stream *stream)
 
     connections << connect(stream, &QHttp2Stream::uploadFinished, this,
                            [this, id]() { sendToStream(id); });
+
+    const QHttpServerConfiguration &config = configuration(m_filter);
+    if (config.requestBodyFileThreshold() > 0 || config.maxBodySize() > 0) {
+        connections << connect(stream, &QHttp2Stream::dataReceived, this,
+                               [this, stream]() { onDataReceived(stream); });
+    }
+}
+
+// Drops the body of stream once it exceeds the maximum size, and writes it
+// to a temporary file once it exceeds the configured threshold, so that it
+// is not kept in memory
+void QHttpServerHttp2ProtocolHandler::onDataReceived(QHttp2Stream *stream)
+{
+    const QHttpServerConfiguration &config = configuration(m_filter);
+    const quint32 id = stream->streamID();
+    if (m_oversizedBodies.contains(id)) {
+        stream->clearDownloadBuffer();
+        return;
+    }
+
+    auto it = m_bodyFiles.find(id);
+    const qint64 buffered = stream->downloadBuffer().byteAmount();
+    const qint64 maxBodySize = config.maxBodySize();
+    if (maxBodySize > 0) {
+        const qint64 written = it != m_bodyFiles.end() && it->second ? it->second->size() : 0;
+        if (buffered + written > maxBodySize) {
+            m_oversizedBodies.insert(id);
+            if (it != m_bodyFiles.end())
+                m_bodyFiles.erase(it);
+            stream->clearDownloadBuffer();
+            return;
+        }
+    }
+
+    if (it == m_bodyFiles.end()) {
+        const qint64 threshold = config.requestBodyFileThreshold();
+        if (threshold <= 0 || buffered <= threshold)
+            return;
+        it = m_bodyFiles.emplace(id, QHttpServerRequestPrivate::createBodyFile()).first;
+    }
+
+    if (!it->second) {
+        stream->clearDownloadBuffer();
+    } else if (!moveDownloadBuffer(stream, it->second.get())) {
+        qCWarning(lcHttpServerHttp2Handler) << "Could not write the request body to"
+                                            << it->second->fileName();
+        it->second.reset();
+    }
 }
 
 void QHttpServerHttp2ProtocolHandler::onStreamHalfClosed(quint32 streamId)
@@ -261,14 +344,30 @@ void QHttpServerHttp2ProtocolHandler::onStreamHalfClosed(quint32 streamId)
     if (!stream)
         return;
 
-    m_request.d->parse(stream);
+    const bool oversized = m_oversizedBodies.remove(streamId);
+    bool bodyComplete = true;
+    std::unique_ptr<QTemporaryFile> bodyFile;
+    if (auto node = m_bodyFiles.extract(streamId)) {
+        bodyFile = std::move(node.mapped());
+        bodyComplete = bodyFile && moveDownloadBuffer(stream, bodyFile.get());
+    }
+    m_request.d->setLimits(configuration(m_filter));
+    if (!m_request.d->parse(stream, std::move(bodyFile)))
+        bodyComplete = false;
 
     qCDebug(lcHttpServerHttp2Handler) << "Request:" << m_request;
 
     QHttpServerResponder responder(this);
     responder.d_ptr->m_streamId = streamId;
+    responder.d_ptr->prepare(m_request, configuration(m_filter));
 
-    if (!m_filter->isRequestWithinRate(m_tcpSocket->peerAddress())) {
+    if (oversized || m_request.d->limitExceeded) {
+        responder.sendResponse(QHttpServerResponse(m_request.d->limitExceeded.value_or(
+                QHttpServerResponder::StatusCode::PayloadTooLarge)));
+    } else if (!bodyComplete) {
+        responder.sendResponse(
+                QHttpServerResponse(QHttpServerResponder::StatusCode::InternalServerError));
+    } else if (!m_filter->isRequestWithinRate(m_tcpSocket->peerAddress())) {
         responder.sendResponse(
                 QHttpServerResponse(QHttpServerResponder::StatusCode::TooManyRequests));
     } else if (!m_server->handleRequest(m_request, responder)) {
@@ -283,6 +382,8 @@ void QHttpServerHttp2ProtocolHandler::onStreamClosed(quint32 streamId)
         disconnect(c);
 
     m_streamQueue.remove(streamId);
+    m_bodyFiles.erase(streamId);
+    m_oversizedBodies.remove(streamId);
 }
 
 void QHttpServerHttp2ProtocolHandler::sendToStream(quint32 streamId)
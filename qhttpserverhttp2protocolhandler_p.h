@@ -11,6 +11,11 @@
 #include <QtNetwork/private/hpack_p.h>
 #include <QtCore/qbytearray.h>
 #include <QtCore/qqueue.h>
+#include <QtCore/qset.h>
+#include <QtCore/qtemporaryfile.h>
+
+#include <map>
+#include <memory>
 
 //
 //  W A R N I N G
@@ -48,14 +53,18 @@ class QHttpServerHttp2ProtocolHandler : public QHttpServerStream
 private:
     QHttpServerHttp2ProtocolHandler(QAbstractHttpServer *server,
                                     QIODevice *socket,
-                                    QHttpServerRequestFilter *filter);
+                                    QHttpServerRequestFilter *filter,
+                                    QObject *parent);
 
-    void responderDestroyed() final;
+    void responderDestroyed(quint32 streamId) final;
     void startHandlingRequest() final;
     void socketDisconnected() final;
 
     void write(const QByteArray &body, const QHttpHeaders &headers,
                QHttpServerResponder::StatusCode status, quint32 streamId) final;
+    void writeSharedBody(const QByteArray &body, const std::shared_ptr<const void> &bodyOwner,
+                         const QHttpHeaders &headers, QHttpServerResponder::StatusCode status,
+                         quint32 streamId) final;
     void write(QHttpServerResponder::StatusCode status, quint32 streamId) final;
     void write(QIODevice *data, const QHttpHeaders &headers,
                QHttpServerResponder::StatusCode status, quint32 streamId) final;
@@ -76,6 +85,7 @@ private slots:
     void onStreamCreated(QHttp2Stream *stream);
     void onStreamClosed(quint32 streamId);
     void onStreamHalfClosed(quint32 streamId);
+    void onDataReceived(QHttp2Stream *stream);
     void sendToStream(quint32 streamId);
 
 private:
@@ -91,6 +101,11 @@ private:
     QHttp2Connection *m_connection;
     QHash<quint32, QList<QMetaObject::Connection>> m_streamConnections;
     QHash<quint32, QHttpServerHttp2Queue> m_streamQueue;
+    // Bodies larger than the configured threshold, by stream. A null file
+    // means writing the body failed.
+    std::map<quint32, std::unique_ptr<QTemporaryFile>> m_bodyFiles;
+    // Streams whose body exceeds the maximum size
+    QSet<quint32> m_oversizedBodies;
     qint32 m_responderCounter = 0;
 };
 
@@ -0,0 +1,248 @@
+// Copyright (C) 2025 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+// Qt-Security score:critical reason:data-parser
+
+#include "qhttpserverrangedevice_p.h"
+
+#include <QtCore/qrandom.h>
+
+#include <algorithm>
+#include <limits>
+
+QT_BEGIN_NAMESPACE
+
+namespace {
+
+// More ranges in one request are not worth serving
+constexpr qsizetype MaxRanges = 16;
+
+// Returns the value of the digits in text, saturated to the maximum of
+// qint64, or -1 if text is not a number
+qint64 parseNumber(QByteArrayView text)
+{
+    if (text.isEmpty())
+        return -1;
+    constexpr qint64 Max = std::numeric_limits<qint64>::max();
+    qint64 value = 0;
+    for (char c : text) {
+        if (c < '0' || c > '9')
+            return -1;
+        const int digit = c - '0';
+        value = value > (Max - digit) / 10 ? Max : value * 10 + digit;
+    }
+    return value;
+}
+
+} // anonymous namespace
+
+/*!
+    \internal
+    \class QHttpServerRangeDevice
+
+    Presents the byte \a ranges of the seekable \a source as one device.
+    A single range is the slice of \a source, several ranges are wrapped in a
+    \c multipart/byteranges body whose parts have the type \a contentType.
+    Takes ownership of \a source.
+*/
+QHttpServerRangeDevice::QHttpServerRangeDevice(QIODevice *source, const QList<Range> &ranges,
+                                               const QByteArray &contentType, QObject *parent)
+    : QIODevice(parent),
+      m_source(source),
+      m_ranges(ranges)
+{
+    Q_ASSERT(!source->isSequential());
+    Q_ASSERT(!ranges.isEmpty());
+    source->setParent(this);
+
+    if (!isMultipart()) {
+        const Range &range = ranges.first();
+        m_parts.append({ 0, range.length(), range.first, QByteArray() });
+        m_size = range.length();
+    } else {
+        m_boundary = "QHttpServer" + QByteArray::number(QRandomGenerator::global()->generate64(), 16);
+        const qint64 sourceSize = source->size();
+        bool first = true;
+        for (const Range &range : ranges) {
+            QByteArray header = first ? "--" : "\r\n--";
+            header += m_boundary + "\r\n";
+            if (!contentType.isEmpty())
+                header += "Content-Type: " + contentType + "\r\n";
+            header += "Content-Range: " + contentRange(range, sourceSize) + "\r\n\r\n";
+            appendLiteral(header);
+            m_parts.append({ m_size, range.length(), range.first, QByteArray() });
+            m_size += range.length();
+            first = false;
+        }
+        appendLiteral("\r\n--" + m_boundary + "--\r\n");
+    }
+
+    open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+}
+
+/*!
+    \internal
+
+    Parses the \c Range header \a value for a representation of \a size
+    bytes. Returns \c std::nullopt if the header is to be ignored, or an
+    empty list if none of the ranges can be satisfied. Overlapping and
+    adjacent ranges are merged, so that a request cannot make the response
+    larger than the representation.
+*/
+std::optional<QList<QHttpServerRangeDevice::Range>>
+QHttpServerRangeDevice::parseRanges(QByteArrayView value, qint64 size)
+{
+    const qsizetype equals = value.indexOf('=');
+    if (equals < 0 || value.first(equals).trimmed().compare("bytes", Qt::CaseInsensitive) != 0)
+        return std::nullopt;
+
+    QList<Range> ranges;
+    qsizetype count = 0;
+    qsizetype from = equals + 1;
+    while (from <= value.size()) {
+        qsizetype end = value.indexOf(',', from);
+        if (end < 0)
+            end = value.size();
+        const QByteArrayView spec = value.sliced(from, end - from).trimmed();
+        from = end + 1;
+        if (spec.isEmpty())
+            continue;
+        if (++count > MaxRanges)
+            return std::nullopt;
+
+        const qsizetype dash = spec.indexOf('-');
+        if (dash < 0)
+            return std::nullopt;
+        const QByteArrayView firstText = spec.first(dash).trimmed();
+        const QByteArrayView lastText = spec.sliced(dash + 1).trimmed();
+
+        if (firstText.isEmpty()) {
+            // The last bytes of the representation
+            const qint64 suffix = parseNumber(lastText);
+            if (suffix < 0)
+                return std::nullopt;
+            if (suffix > 0 && size > 0)
+                ranges.append({ qMax(size - suffix, 0), size - 1 });
+            continue;
+        }
+
+        const qint64 first = parseNumber(firstText);
+        const qint64 last = lastText.isEmpty() ? std::numeric_limits<qint64>::max()
+                                               : parseNumber(lastText);
+        if (first < 0 || last < first)
+            return std::nullopt;
+        if (first < size)
+            ranges.append({ first, qMin(last, size - 1) });
+    }
+    if (count == 0)
+        return std::nullopt;
+
+    if (ranges.size() > 1) {
+        std::sort(ranges.begin(), ranges.end(), [](const Range &lhs, const Range &rhs) {
+            return lhs.first < rhs.first;
+        });
+        QList<Range> merged;
+        merged.reserve(ranges.size());
+        for (const Range &range : std::as_const(ranges)) {
+            if (!merged.isEmpty() && range.first <= merged.last().last + 1)
+                merged.last().last = qMax(merged.last().last, range.last);
+            else
+                merged.append(range);
+        }
+        ranges = std::move(merged);
+    }
+    return ranges;
+}
+
+/*!
+    \internal
+
+    Returns the \c Content-Range value of \a range in a representation of
+    \a size bytes.
+*/
+QByteArray QHttpServerRangeDevice::contentRange(const Range &range, qint64 size)
+{
+    return "bytes " + QByteArray::number(range.first) + '-' + QByteArray::number(range.last)
+            + '/' + QByteArray::number(size);
+}
+
+/*!
+    \internal
+
+    Returns the \c Content-Type of a multipart body.
+*/
+QByteArray QHttpServerRangeDevice::contentType() const
+{
+    Q_ASSERT(isMultipart());
+    return "multipart/byteranges; boundary=" + m_boundary;
+}
+
+/*!
+    \internal
+*/
+bool QHttpServerRangeDevice::seek(qint64 pos)
+{
+    if (pos > m_size || !QIODevice::seek(pos))
+        return false;
+    m_position = pos;
+    return true;
+}
+
+/*!
+    \internal
+*/
+qint64 QHttpServerRangeDevice::readData(char *data, qint64 maxSize)
+{
+    qint64 total = 0;
+    for (const Part &part : std::as_const(m_parts)) {
+        if (total == maxSize)
+            break;
+        if (m_position >= part.offset + part.size)
+            continue;
+
+        const qint64 offset = m_position - part.offset;
+        const qint64 count = qMin(maxSize - total, part.size - offset);
+        if (!part.literal.isEmpty()) {
+            memcpy(data + total, part.literal.constData() + offset, size_t(count));
+            total += count;
+            m_position += count;
+            continue;
+        }
+
+        if (!m_source->seek(part.sourceOffset + offset)) {
+            setErrorString(m_source->errorString());
+            return total > 0 ? total : -1;
+        }
+        const qint64 read = m_source->read(data + total, count);
+        if (read <= 0) {
+            // The source shrank since the ranges were computed
+            setErrorString(m_source->errorString());
+            return total > 0 ? total : -1;
+        }
+        total += read;
+        m_position += read;
+        if (read < count)
+            break;
+    }
+    return total;
+}
+
+/*!
+    \internal
+*/
+qint64 QHttpServerRangeDevice::writeData(const char *data, qint64 maxSize)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(maxSize);
+    return -1;
+}
+
+/*!
+    \internal
+*/
+void QHttpServerRangeDevice::appendLiteral(const QByteArray &literal)
+{
+    m_parts.append({ m_size, literal.size(), 0, literal });
+    m_size += literal.size();
+}
+
+QT_END_NAMESPACE
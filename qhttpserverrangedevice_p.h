@@ -0,0 +1,78 @@
+// Copyright (C) 2025 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+// Qt-Security score:significant reason:default
+
+#pragma once
+
+#include <QtCore/qglobal.h>
+#include <QtCore/qbytearray.h>
+#include <QtCore/qiodevice.h>
+#include <QtCore/qlist.h>
+
+#include <optional>
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists for the convenience
+// of QHttpServer. This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+
+QT_BEGIN_NAMESPACE
+
+class QHttpServerRangeDevice : public QIODevice
+{
+    Q_OBJECT
+
+public:
+    struct Range
+    {
+        qint64 first;
+        qint64 last;
+
+        qint64 length() const { return last - first + 1; }
+    };
+
+    QHttpServerRangeDevice(QIODevice *source, const QList<Range> &ranges,
+                           const QByteArray &contentType, QObject *parent = nullptr);
+
+    static std::optional<QList<Range>> parseRanges(QByteArrayView value, qint64 size);
+    static QByteArray contentRange(const Range &range, qint64 size);
+
+    QIODevice *source() const { return m_source; }
+    const QList<Range> &ranges() const { return m_ranges; }
+    bool isMultipart() const { return m_ranges.size() > 1; }
+    QByteArray contentType() const;
+
+    bool isSequential() const override { return false; }
+    qint64 size() const override { return m_size; }
+    bool seek(qint64 pos) override;
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *data, qint64 maxSize) override;
+
+private:
+    // A piece of the body, either literal bytes or a slice of the source
+    struct Part
+    {
+        qint64 offset;
+        qint64 size;
+        qint64 sourceOffset;
+        QByteArray literal;
+    };
+
+    void appendLiteral(const QByteArray &literal);
+
+    QIODevice *const m_source;
+    const QList<Range> m_ranges;
+    QByteArray m_boundary;
+    QList<Part> m_parts;
+    qint64 m_size = 0;
+    qint64 m_position = 0;
+};
+
+QT_END_NAMESPACE
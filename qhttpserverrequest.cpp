@@ -4,6 +4,7 @@
 
 #include "qhttpserverrequest_p.h"
 
+#include "qhttpserverdelimiterscanner_p.h"
 #include "qhttpserverrequest.h"
 #include <QtNetwork/qhttpheaders.h>
 
@@ -17,10 +18,16 @@
 #include <QtNetwork/private/qhttp2connection_p.h>
 #endif
 
+#include <algorithm>
+#include <limits>
+#include <utility>
+
 QT_BEGIN_NAMESPACE
 
 using namespace Qt::StringLiterals;
 
+Q_STATIC_LOGGING_CATEGORY(lcHttpServerRequest, "qt.httpserver.request")
+
 #if !defined(QT_NO_DEBUG_STREAM)
 
 /*!
@@ -37,7 +44,8 @@ QDebug operator<<(QDebug debug, const QHttpServerRequest &request)
     debug << "(Url: " << request.url() << ")";
     debug << "(Headers: " << request.headers() << ")";
     debug << "(RemoteHost: " << request.remoteAddress() << ")";
-    debug << "(BodySize: " << request.body().size() << ")";
+    debug << "(BodySize: "
+          << (request.d->bodyFile ? request.d->bodyFile->size() : request.d->body.size()) << ")";
     debug << ')';
     return debug;
 }
@@ -68,6 +76,61 @@ QHttpServerRequest::Method parseRequestMethod(QByteArrayView str)
         return QHttpServerRequest::Method::Unknown;
 }
 
+// The request line and the header block are scanned in blocks of this size,
+// so that the socket is not asked for every single byte.
+constexpr qint64 PeekBlockSize = 4096;
+
+// The largest body that is allocated at once when its length is declared.
+// Larger bodies grow as they arrive, so that a Content-Length alone does not
+// commit memory.
+constexpr qsizetype MaxPreallocatedBody = 8 * 1024 * 1024;
+
+// Room for the method and the protocol version next to the URL in the
+// request line
+constexpr qsizetype MaxRequestLineOverhead = 64;
+
+bool isLeadingWhitespace(char c)
+{
+    return c == '\v' || c == '\n' || c == '\r' || c == ' ' || c == '\t';
+}
+
+// Returns the size of the header block at the beginning of \a block including
+// the empty line that terminates it, or -1 if the block is not complete yet.
+// Only line feeds at or after \a from are considered. As per HTTP rfc, the
+// header endings will be marked by CRLFCRLF, but we will allow CRLFCRLF,
+// CRLFLF, LFCRLF and LFLF. There is also the case where there are no headers
+// at all and the block consists of just the line ending.
+qsizetype headerBlockSize(QByteArrayView block, qsizetype from)
+{
+    using QHttpServerDelimiterScanner::indexOfAny;
+    for (qsizetype i = indexOfAny(block, "\n", from); i != -1; i = indexOfAny(block, "\n", i + 1)) {
+        if (i == 0 || block[i - 1] == '\n')
+            return i + 1;
+        if (block[i - 1] == '\r' && (i == 1 || block[i - 2] == '\n'))
+            return i + 1;
+    }
+    return -1;
+}
+
+// tchar as per RFC 9110, section 5.6.2
+bool isTokenChar(char c)
+{
+    if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9'))
+        return true;
+    switch (c) {
+    case '!': case '#': case '$': case '%': case '&': case '\'': case '*': case '+':
+    case '-': case '.': case '^': case '_': case '`': case '|': case '~':
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool isFieldWhitespace(char c)
+{
+    return c == ' ' || c == '\t';
+}
+
 } // anonymous namespace
 
 /*!
@@ -75,8 +138,10 @@ QHttpServerRequest::Method parseRequestMethod(QByteArrayView str)
 */
 bool QHttpServerRequestPrivate::parseRequestLine(QByteArrayView line)
 {
+    using QHttpServerDelimiterScanner::indexOfAny;
+
     // Request-Line   = Method SP Request-URI SP HTTP-Version CRLF
-    auto i = line.indexOf(' ');
+    auto i = indexOfAny(line, " ");
     if (i == -1)
         return false;
     const auto requestMethod = line.first(i);
@@ -85,11 +150,15 @@ bool QHttpServerRequestPrivate::parseRequestLine(QByteArrayView line)
     while (i < line.size() && line[i] == ' ')
         i++;
 
-    auto j = line.indexOf(' ', i);
+    auto j = indexOfAny(line, " ", i);
     if (j == -1)
         return false;
 
     const auto requestUrl = line.sliced(i, j - i);
+    if (maxUrlLength > 0 && requestUrl.size() > maxUrlLength) {
+        limitExceeded = QHttpServerResponder::StatusCode::UriTooLong;
+        return false;
+    }
     i = j + 1;
 
     while (i < line.size() && line[i] == ' ')
@@ -98,14 +167,12 @@ bool QHttpServerRequestPrivate::parseRequestLine(QByteArrayView line)
     if (i >= line.size())
         return false;
 
-    j = line.indexOf(' ', i);
+    j = indexOfAny(line, " ", i);
 
     const auto protocol = j == -1 ? line.sliced(i) : line.sliced(i, j - i);
     if (protocol.size() != 8 || !protocol.startsWith("HTTP"))
         return false;
 
-    parser.setMajorVersion(protocol[5] - '0');
-    parser.setMinorVersion(protocol[7] - '0');
     majorVersion = protocol[5] - '0';
     minorVersion = protocol[7] - '0';
 
@@ -116,49 +183,65 @@ bool QHttpServerRequestPrivate::parseRequestLine(QByteArrayView line)
 
 /*!
     \internal
+
+    Peeks at the available data in blocks and only consumes from \a socket
+    what belongs to the request line.
 */
 qsizetype QHttpServerRequestPrivate::readRequestLine(QIODevice *socket)
 {
-    if (fragment.isEmpty()) {
-        // reserve bytes for the request line. This is better than always append() which reallocs
-        // the byte array
-        fragment.reserve(32);
-    }
-
     qsizetype bytes = 0;
-    char c;
-    qsizetype haveRead = 0;
 
-    do {
-        haveRead = socket->read(&c, 1);
-        if (haveRead == -1)
-            return -1; // unexpected EOF
-        else if (haveRead == 0)
+    while (true) {
+        const qsizetype oldSize = fragment.size();
+        const qint64 toPeek = qMin(socket->bytesAvailable(), PeekBlockSize);
+        if (toPeek <= 0)
             break; // read more later
-        else if (haveRead == 1 && fragment.size() == 0
-                 && (c == '\v' || c == '\n' || c == '\r' || c == ' ' || c == '\t'))
-            continue; // Ignore all whitespace that was trailing from a previous request on that
-                      // socket
 
-        bytes++;
+        fragment.resize(oldSize + toPeek);
+        const qint64 peeked = socket->peek(fragment.data() + oldSize, toPeek);
+        if (peeked <= 0) {
+            fragment.truncate(oldSize);
+            if (peeked == -1)
+                return -1; // unexpected EOF
+            break; // read more later
+        }
 
-        // allow both CRLF & LF (only) line endings
-        if (c == '\n') {
-            // remove the CR at the end
-            if (fragment.endsWith('\r')) {
-                fragment.truncate(fragment.size() - 1);
-            }
-            bool ok = parseRequestLine(fragment);
-            state = State::ReadingHeader;
-            fragment.clear();
-            if (!ok) {
+        const QByteArrayView block(fragment.constData() + oldSize, peeked);
+        qsizetype begin = 0;
+        if (oldSize == 0) {
+            // Ignore all whitespace that was trailing from a previous request on that socket
+            while (begin < block.size() && isLeadingWhitespace(block[begin]))
+                ++begin;
+        }
+
+        const qsizetype lineFeed = QHttpServerDelimiterScanner::indexOfAny(block, "\n", begin);
+        const qsizetype consumed = lineFeed == -1 ? block.size() : lineFeed + 1;
+        socket->skip(consumed);
+        bytes += consumed;
+
+        // keep the line without its line ending (and without leading whitespace)
+        fragment.truncate(oldSize + (lineFeed == -1 ? consumed : lineFeed));
+        if (begin)
+            fragment.remove(0, begin);
+
+        if (lineFeed == -1) {
+            if (maxUrlLength > 0 && fragment.size() > maxUrlLength + MaxRequestLineOverhead) {
+                limitExceeded = QHttpServerResponder::StatusCode::UriTooLong;
                 return -1;
             }
-            break;
-        } else {
-            fragment.append(c);
+            continue;
         }
-    } while (haveRead == 1);
+
+        // allow both CRLF & LF (only) line endings
+        if (fragment.endsWith('\r'))
+            fragment.chop(1);
+        const bool ok = parseRequestLine(fragment);
+        state = State::ReadingHeader;
+        fragment.clear();
+        if (!ok)
+            return -1;
+        break;
+    }
 
     return bytes;
 }
@@ -169,16 +252,161 @@ qsizetype QHttpServerRequestPrivate::readRequestLine(QIODevice *socket)
 qint64 QHttpServerRequestPrivate::contentLength() const
 {
     bool ok = false;
-    QByteArray value = parser.firstHeaderField("content-length");
-    qint64 length = value.toULongLong(&ok);
+    qint64 length = firstHeaderValue("content-length").toULongLong(&ok);
     if (ok)
         return length;
     return -1; // the header field is not set
 }
 
+/*!
+    \internal
+
+    Builds the index of header fields in headerBlock. Obsolete line folding
+    is replaced by spaces in place, so every value stays one contiguous view
+    into the block. Returns \c false if the block contains a malformed field.
+*/
+bool QHttpServerRequestPrivate::indexHeaderBlock()
+{
+    using QHttpServerDelimiterScanner::indexOfAny;
+
+    headerFields.clear();
+    headers.reset();
+
+    char *data = headerBlock.data();
+    const qsizetype size = headerBlock.size();
+    qsizetype pos = 0;
+    while (pos < size) {
+        const qsizetype colon = indexOfAny(headerBlock, ":\n", pos);
+        if (colon == -1)
+            return false;
+        if (data[colon] == '\n') {
+            // a line without a colon is only valid as the empty line ending the block
+            return colon == pos || (colon == pos + 1 && data[pos] == '\r');
+        }
+
+        const qsizetype nameSize = colon - pos;
+        if (nameSize == 0)
+            return false;
+        for (qsizetype i = pos; i < colon; ++i) {
+            if (!isTokenChar(data[i]))
+                return false;
+        }
+
+        qsizetype lineFeed = indexOfAny(headerBlock, "\n", colon + 1);
+        if (lineFeed == -1)
+            lineFeed = size;
+        qsizetype valueEnd = lineFeed > colon + 1 && data[lineFeed - 1] == '\r'
+                ? lineFeed - 1 : lineFeed;
+        // obs-fold: a line starting with whitespace continues the previous value
+        while (lineFeed + 1 < size && isFieldWhitespace(data[lineFeed + 1])) {
+            std::fill(data + valueEnd, data + lineFeed + 1, ' ');
+            lineFeed = indexOfAny(headerBlock, "\n", lineFeed + 1);
+            if (lineFeed == -1)
+                lineFeed = size;
+            valueEnd = data[lineFeed - 1] == '\r' ? lineFeed - 1 : lineFeed;
+        }
+
+        qsizetype valueBegin = colon + 1;
+        while (valueBegin < valueEnd && isFieldWhitespace(data[valueBegin]))
+            ++valueBegin;
+        while (valueEnd > valueBegin && isFieldWhitespace(data[valueEnd - 1]))
+            --valueEnd;
+        for (qsizetype i = valueBegin; i < valueEnd; ++i) {
+            const uchar c = data[i];
+            if ((c < 0x20 && c != '\t') || c == 0x7f)
+                return false;
+        }
+
+        headerFields.append({ pos, nameSize, valueBegin, valueEnd - valueBegin });
+        pos = lineFeed + 1;
+    }
+    return true;
+}
+
+/*!
+    \internal
+
+    Appends a header field that did not arrive as part of a header block,
+    e.g. from an HTTP/2 HEADERS frame.
+*/
+void QHttpServerRequestPrivate::appendHeaderField(QByteArrayView name, QByteArrayView value)
+{
+    const qsizetype nameOffset = headerBlock.size();
+    headerBlock.append(name);
+    const qsizetype valueOffset = headerBlock.size();
+    headerBlock.append(value);
+    headerFields.append({ nameOffset, name.size(), valueOffset, value.size() });
+    headers.reset();
+}
+
+/*!
+    \internal
+*/
+void QHttpServerRequestPrivate::clearHeaders()
+{
+    headerBlock.clear();
+    headerFields.clear();
+    headers.reset();
+}
+
+/*!
+    \internal
+
+    Returns the value of the first header field called \a name, or an empty
+    view if there is none.
+*/
+QByteArrayView QHttpServerRequestPrivate::firstHeaderValue(QByteArrayView name) const
+{
+    for (qsizetype i = 0; i < headerFields.size(); ++i) {
+        if (headerNameAt(i).compare(name, Qt::CaseInsensitive) == 0)
+            return headerValueAt(i);
+    }
+    return {};
+}
+
+/*!
+    \internal
+
+    Returns the values of all header fields called \a name, separated by
+    commas.
+*/
+QByteArray QHttpServerRequestPrivate::headerField(QByteArrayView name) const
+{
+    QByteArray result;
+    bool first = true;
+    for (qsizetype i = 0; i < headerFields.size(); ++i) {
+        if (headerNameAt(i).compare(name, Qt::CaseInsensitive) != 0)
+            continue;
+        if (!first)
+            result.append(", ");
+        result.append(headerValueAt(i));
+        first = false;
+    }
+    return result;
+}
+
 /*!
     \internal
 */
+const QHttpHeaders &QHttpServerRequestPrivate::materializedHeaders() const
+{
+    // The handler and the thread of the connection may both ask for it
+    QMutexLocker locker(&headersMutex);
+    if (!headers) {
+        headers.emplace();
+        headers->reserve(headerFields.size());
+        for (qsizetype i = 0; i < headerFields.size(); ++i)
+            headers->append(headerNameAt(i), headerValueAt(i));
+    }
+    return *headers;
+}
+
+/*!
+    \internal
+
+    Peeks at the available data in blocks and only consumes from \a socket
+    what belongs to the header block.
+*/
 qsizetype QHttpServerRequestPrivate::readHeader(QIODevice *socket)
 {
     if (fragment.isEmpty()) {
@@ -189,44 +417,50 @@ qsizetype QHttpServerRequestPrivate::readHeader(QIODevice *socket)
         fragment.reserve(512);
     }
 
-    qint64 bytes = 0;
-    char c = 0;
+    qsizetype bytes = 0;
     bool allHeaders = false;
-    qint64 haveRead = 0;
-    do {
-        haveRead = socket->read(&c, 1);
-        if (haveRead == 0) {
-            // read more later
-            break;
-        } else if (haveRead == -1) {
-            // connection broke down
+    while (!allHeaders) {
+        const qsizetype oldSize = fragment.size();
+        const qint64 toPeek = qMin(socket->bytesAvailable(), PeekBlockSize);
+        if (toPeek <= 0)
+            break; // read more later
+
+        fragment.resize(oldSize + toPeek);
+        const qint64 peeked = socket->peek(fragment.data() + oldSize, toPeek);
+        if (peeked <= 0) {
+            fragment.truncate(oldSize);
+            if (peeked == -1)
+                return -1; // connection broke down
+            break; // read more later
+        }
+        fragment.truncate(oldSize + peeked);
+
+        const qsizetype blockSize = headerBlockSize(fragment, oldSize);
+        allHeaders = blockSize != -1;
+        const qsizetype consumed = allHeaders ? blockSize - oldSize : peeked;
+        socket->skip(consumed);
+        fragment.truncate(oldSize + consumed);
+        bytes += consumed;
+
+        if (maxHeaderSize > 0 && fragment.size() > maxHeaderSize) {
+            limitExceeded = QHttpServerResponder::StatusCode::RequestHeaderFieldsTooLarge;
             return -1;
-        } else {
-            fragment.append(c);
-            bytes++;
-
-            if (c == '\n') {
-                // check for possible header endings. As per HTTP rfc,
-                // the header endings will be marked by CRLFCRLF. But
-                // we will allow CRLFCRLF, CRLFLF, LFCRLF, LFLF
-                if (fragment.endsWith("\n\r\n") || fragment.endsWith("\n\n"))
-                    allHeaders = true;
-
-                // there is another case: We have no headers. Then the fragment equals just the line
-                // ending
-                if ((fragment.size() == 2 && fragment.endsWith("\r\n"))
-                    || (fragment.size() == 1 && fragment.endsWith("\n")))
-                    allHeaders = true;
-            }
         }
-    } while (!allHeaders && haveRead > 0);
+    }
 
     // we received all headers now parse them
     if (allHeaders) {
-        parser.parseHeaders(fragment);
-        fragment.clear(); // next fragment
+        headerBlock = std::exchange(fragment, QByteArray()); // next fragment
+        if (!indexHeaderBlock())
+            return -1;
+        if (maxHeaderCount > 0 && headerFields.size() > maxHeaderCount) {
+            limitExceeded = QHttpServerResponder::StatusCode::RequestHeaderFieldsTooLarge;
+            return -1;
+        }
+        if (!lazyHeaders)
+            materializedHeaders();
 
-        auto hostUrl = QString::fromUtf8(headerField("host"));
+        auto hostUrl = QString::fromUtf8(firstHeaderValue("host"));
         if (!hostUrl.isEmpty())
             url.setAuthority(hostUrl);
 
@@ -246,6 +480,10 @@ qsizetype QHttpServerRequestPrivate::readHeader(QIODevice *socket)
             url.setPort(port);
 
         bodyLength = contentLength(); // cache the length
+        if (maxBodySize > 0 && bodyLength > maxBodySize) {
+            limitExceeded = QHttpServerResponder::StatusCode::PayloadTooLarge;
+            return -1;
+        }
 
         // cache isChunked() since it is called often
         // FIXME: the RFC says that anything but "identity" should be interpreted as chunked (4.4
@@ -256,7 +494,7 @@ qsizetype QHttpServerRequestPrivate::readHeader(QIODevice *socket)
         upgrade = connectionHeaderField.toLower().contains("upgrade");
 
         if (chunkedTransferEncoding || bodyLength > 0) {
-            if (headerField("expect").compare("100-continue", Qt::CaseInsensitive) == 0)
+            if (firstHeaderValue("expect").compare("100-continue", Qt::CaseInsensitive) == 0)
                 state = State::ExpectContinue;
             else
                 state = State::ReadingData;
@@ -333,6 +571,8 @@ bool QHttpServerRequestPrivate::parse(QIODevice *socket)
             read = readHeader(socket);
             continue;
         case State::ExpectContinue:
+            if (deferContinue)
+                return true;
             read = sendContinue(socket);
             continue;
         case State::ReadingData:
@@ -342,8 +582,12 @@ bool QHttpServerRequestPrivate::parse(QIODevice *socket)
                 read = readBodyFast(socket);
 
             if (state == State::AllDone) {
-                body = bodyBuffer.readAll();
-                bodyBuffer.clear();
+                if (streamingBody) {
+                    streamingBody->finish();
+                } else if (bodyFile) {
+                    if (!bodyFile->flush() || !bodyFile->seek(0))
+                        return false;
+                }
             }
 
             continue;
@@ -355,13 +599,24 @@ bool QHttpServerRequestPrivate::parse(QIODevice *socket)
 }
 
 #if QT_CONFIG(http)
-bool QHttpServerRequestPrivate::parse(QHttp2Stream *socket)
+/*!
+    \internal
+
+    Takes the request from \a socket. If its body was written to a
+    temporary file while it was received, \a spilledBody is that file.
+    Returns \c false with limitExceeded set if the request exceeds one of
+    the limits, and without if the body file cannot be read.
+*/
+bool QHttpServerRequestPrivate::parse(QHttp2Stream *socket,
+                                      std::unique_ptr<QTemporaryFile> spilledBody)
 {
-    parser.clear();
+    clearHeaders();
+    limitExceeded.reset();
 
     majorVersion = 2;
     minorVersion = 0;
 
+    qsizetype pathSize = 0;
     for (const auto &pair : socket->receivedHeaders()) {
         if (pair.name == ":method") {
             method = parseRequestMethod(pair.value);
@@ -370,13 +625,16 @@ bool QHttpServerRequestPrivate::parse(QHttp2Stream *socket)
         } else if (pair.name == ":authority") {
             url.setAuthority(QLatin1StringView(pair.value));
         } else if (pair.name == ":path") {
+            pathSize = pair.value.size();
             auto path = QUrl::fromEncoded(pair.value);
             url.setPath(path.path());
             url.setQuery(path.query());
         } else {
-            parser.appendHeaderField(pair.name, pair.value);
+            appendHeaderField(pair.name, pair.value);
         }
     }
+    if (!lazyHeaders)
+        materializedHeaders();
 
     if (url.scheme().isEmpty())
         url.setScheme(u"https"_s);
@@ -389,9 +647,26 @@ bool QHttpServerRequestPrivate::parse(QHttp2Stream *socket)
 
     bodyLength = contentLength(); // cache the length
 
-    body = socket->downloadBuffer().readAll();
+    bodyReader.reset();
+    bodyFile = std::move(spilledBody);
+    if (bodyFile) {
+        body.clear();
+        if (!bodyFile->flush() || !bodyFile->seek(0))
+            return false;
+    } else {
+        body = socket->downloadBuffer().readAll();
+    }
 
-    return true;
+    const qint64 bodySize = bodyFile ? bodyFile->size() : body.size();
+    if (maxUrlLength > 0 && pathSize > maxUrlLength) {
+        limitExceeded = QHttpServerResponder::StatusCode::UriTooLong;
+    } else if ((maxHeaderSize > 0 && headerBlock.size() > maxHeaderSize)
+               || (maxHeaderCount > 0 && headerFields.size() > maxHeaderCount)) {
+        limitExceeded = QHttpServerResponder::StatusCode::RequestHeaderFieldsTooLarge;
+    } else if (maxBodySize > 0 && qMax(bodyLength, bodySize) > maxBodySize) {
+        limitExceeded = QHttpServerResponder::StatusCode::PayloadTooLarge;
+    }
+    return !limitExceeded;
 }
 #endif
 
@@ -400,7 +675,7 @@ bool QHttpServerRequestPrivate::parse(QHttp2Stream *socket)
 */
 void QHttpServerRequestPrivate::clear()
 {
-    parser.clear();
+    clearHeaders();
     bodyLength = -1;
     contentRead = 0;
     chunkedTransferEncoding = false;
@@ -411,9 +686,141 @@ void QHttpServerRequestPrivate::clear()
     majorVersion = 0;
     minorVersion = 0;
 
+    limitExceeded.reset();
+
     fragment.clear();
-    bodyBuffer.clear();
     body.clear();
+    streamingBody.reset();
+    bodyFile.reset();
+    bodyReader.reset();
+}
+
+/*!
+    \internal
+
+    Takes the limits for the requests to parse from \a configuration.
+*/
+void QHttpServerRequestPrivate::setLimits(const QHttpServerConfiguration &configuration)
+{
+    maxUrlLength = configuration.maxUrlLength();
+    maxHeaderSize = configuration.maxHeaderSize();
+    maxHeaderCount = configuration.maxHeaderCount();
+    maxBodySize = configuration.maxBodySize();
+    bodyFileThreshold = configuration.requestBodyFileThreshold();
+    lazyHeaders = configuration.isLazyRequestHeadersEnabled();
+}
+
+/*!
+    \internal
+
+    Returns how much of the body can be read before the handler of a
+    streaming request has to catch up.
+*/
+qsizetype QHttpServerRequestPrivate::bodyRoom() const
+{
+    if (!streamingBody)
+        return std::numeric_limits<qsizetype>::max();
+    return qsizetype(qMin(streamingBody->room(), qint64(std::numeric_limits<qsizetype>::max())));
+}
+
+/*!
+    \internal
+
+    Reads up to \a size bytes of the body from \a socket. A body kept in
+    memory is read straight into its final place, which is allocated once
+    when the length of the body is known, and grows geometrically when it
+    is not. The body is moved to a temporary file once it exceeds
+    bodyFileThreshold. Returns the number of bytes read, or -1 if the file
+    could not be written.
+*/
+qsizetype QHttpServerRequestPrivate::readBodyData(QIODevice *socket, qsizetype size)
+{
+    if (!streamingBody && !bodyFile && body.isEmpty() && bodyFileThreshold > 0
+        && bodyLength > bodyFileThreshold && !spillBody()) {
+        return -1;
+    }
+
+    if (streamingBody || bodyFile) {
+        QByteArray data(size, Qt::Uninitialized);
+        const qint64 haveRead = socket->read(data.data(), size);
+        if (haveRead <= 0)
+            return 0; // ### error checking here
+        data.truncate(haveRead);
+        if (streamingBody) {
+            streamingBody->append(data);
+        } else if (bodyFile->write(data) != data.size()) {
+            qCWarning(lcHttpServerRequest) << "Could not write the request body to"
+                                           << bodyFile->fileName() << bodyFile->errorString();
+            return -1;
+        }
+        return haveRead;
+    }
+
+    const qsizetype oldSize = body.size();
+    if (body.capacity() < oldSize + size) {
+        const qsizetype capacity = oldSize == 0 && bodyLength > 0
+                ? qMin(bodyLength, MaxPreallocatedBody)
+                : 2 * body.capacity();
+        body.reserve(qMax(capacity, oldSize + size));
+    }
+    body.resize(oldSize + size);
+    const qint64 haveRead = socket->read(body.data() + oldSize, size);
+    body.truncate(oldSize + qMax(haveRead, qint64(0)));
+    if (haveRead <= 0)
+        return 0; // ### error checking here
+
+    if (bodyFileThreshold > 0 && body.size() > bodyFileThreshold && !spillBody())
+        return -1;
+    return haveRead;
+}
+
+/*!
+    \internal
+
+    Moves what was read of the body so far to a new temporary file.
+*/
+bool QHttpServerRequestPrivate::spillBody()
+{
+    bodyFile = createBodyFile();
+    if (!bodyFile)
+        return false;
+    if (bodyFile->write(body) != body.size()) {
+        qCWarning(lcHttpServerRequest) << "Could not write the request body to"
+                                       << bodyFile->fileName() << bodyFile->errorString();
+        return false;
+    }
+    body = QByteArray();
+    return true;
+}
+
+/*!
+    \internal
+
+    Returns an open temporary file for a request body, or \c nullptr if
+    none can be created.
+*/
+std::unique_ptr<QTemporaryFile> QHttpServerRequestPrivate::createBodyFile()
+{
+    auto file = std::make_unique<QTemporaryFile>();
+    if (!file->open()) {
+        qCWarning(lcHttpServerRequest) << "Could not create a file for the request body:"
+                                       << file->errorString();
+        return nullptr;
+    }
+    return file;
+}
+
+/*!
+    \internal
+
+    Hands the rest of the body to the handler while it arrives, beginning
+    with what was read already.
+*/
+void QHttpServerRequestPrivate::startStreamingBody()
+{
+    Q_ASSERT(state == State::ReadingData);
+    streamingBody = std::make_unique<QHttpServerRequestBodyDevice>();
+    streamingBody->append(std::exchange(body, QByteArray()));
 }
 
 // The body reading functions were mostly copied from QHttpNetworkReplyPrivate
@@ -426,20 +833,14 @@ void QHttpServerRequestPrivate::clear()
 qsizetype QHttpServerRequestPrivate::readBodyFast(QIODevice *socket)
 {
 
-    qsizetype toBeRead = qMin(socket->bytesAvailable(), bodyLength - contentRead);
+    qsizetype toBeRead = qMin(qMin(socket->bytesAvailable(), bodyLength - contentRead),
+                              bodyRoom());
     if (!toBeRead)
         return 0;
 
-    QByteArray bd;
-    bd.resize(toBeRead);
-    qsizetype haveRead = socket->read(bd.data(), toBeRead);
-    if (haveRead == -1) {
-        bd.clear();
-        return 0; // ### error checking here;
-    }
-    bd.resize(haveRead);
-
-    bodyBuffer.append(bd);
+    const qsizetype haveRead = readBodyData(socket, toBeRead);
+    if (haveRead <= 0)
+        return haveRead;
 
     contentRead += haveRead;
 
@@ -458,24 +859,21 @@ qsizetype QHttpServerRequestPrivate::readRequestBodyRaw(QIODevice *socket, qsize
     qsizetype bytes = 0;
     Q_ASSERT(socket);
 
-    int toBeRead = qMin<qsizetype>(128 * 1024, qMin<qint64>(size, socket->bytesAvailable()));
+    int toBeRead = qMin<qsizetype>(qMin<qsizetype>(128 * 1024, bodyRoom()),
+                                   qMin<qint64>(size, socket->bytesAvailable()));
 
     while (toBeRead > 0) {
-        QByteArray byteData;
-        byteData.resize(toBeRead);
-        qsizetype haveRead = socket->read(byteData.data(), byteData.size());
-        if (haveRead <= 0) {
-            // ### error checking here
-            byteData.clear();
+        const qsizetype haveRead = readBodyData(socket, toBeRead);
+        if (haveRead == -1)
+            return -1;
+        if (haveRead == 0)
             return bytes;
-        }
 
-        byteData.resize(haveRead);
-        bodyBuffer.append(byteData);
         bytes += haveRead;
         size -= haveRead;
 
-        toBeRead = qMin<qsizetype>(128 * 1024, qMin<qsizetype>(size, socket->bytesAvailable()));
+        toBeRead = qMin<qsizetype>(qMin<qsizetype>(128 * 1024, bodyRoom()),
+                                   qMin<qsizetype>(size, socket->bytesAvailable()));
     }
     return bytes;
 }
@@ -509,6 +907,10 @@ qsizetype QHttpServerRequestPrivate::readRequestBodyChunked(QIODevice *socket)
             bytes += getChunkSize(socket, &currentChunkSize);
             if (currentChunkSize == -1)
                 break;
+            if (maxBodySize > 0 && currentChunkSize > maxBodySize - contentRead) {
+                limitExceeded = QHttpServerResponder::StatusCode::PayloadTooLarge;
+                return -1;
+            }
         }
         // if the chunk size is 0, end of the stream
         if (currentChunkSize == 0 || lastChunkRead) {
@@ -534,8 +936,13 @@ qsizetype QHttpServerRequestPrivate::readRequestBodyChunked(QIODevice *socket)
 
         // otherwise, try to begin reading this chunk / to read what is missing for this chunk
         qsizetype haveRead = readRequestBodyRaw(socket, currentChunkSize - currentChunkRead);
+        if (haveRead == -1)
+            return -1;
         currentChunkRead += haveRead;
+        contentRead += haveRead;
         bytes += haveRead;
+        if (haveRead == 0)
+            break; // the handler of a streaming request has to catch up
 
         // ### error checking here
     }
@@ -544,41 +951,55 @@ qsizetype QHttpServerRequestPrivate::readRequestBodyChunked(QIODevice *socket)
 
 /*!
     \internal
+
+    Reads the next chunk-size line from \a socket into \a chunkSize, skipping
+    blank lines such as the CRLF that terminates the previous chunk. Sets
+    \a chunkSize to -1 if the line is not complete yet.
 */
 qsizetype QHttpServerRequestPrivate::getChunkSize(QIODevice *socket, qsizetype *chunkSize)
 {
+    using QHttpServerDelimiterScanner::indexOfAny;
+
     qsizetype bytes = 0;
-    char crlf[2];
     *chunkSize = -1;
 
-    int bytesAvailable = socket->bytesAvailable();
-    // FIXME rewrite to permanent loop without bytesAvailable
-    while (bytesAvailable > bytes) {
-        qsizetype sniffedBytes = socket->peek(crlf, 2);
-        int fragmentSize = fragment.size();
-
-        // check the next two bytes for a "\r\n", skip blank lines
-        if ((fragmentSize && sniffedBytes == 2 && crlf[0] == '\r' && crlf[1] == '\n')
-            || (fragmentSize > 1 && fragment.endsWith('\r') && crlf[0] == '\n')) {
-            bytes += socket->read(crlf, 1); // read the \r or \n
-            if (crlf[0] == '\r')
-                bytes += socket->read(crlf, 1); // read the \n
-            bool ok = false;
-            // ignore the chunk-extension
-            fragment = fragment.mid(0, fragment.indexOf(';')).trimmed();
-            *chunkSize = fragment.toLong(&ok, 16);
-            fragment.clear();
-            break; // size done
-        } else {
-            // read the fragment to the buffer
-            char c = 0;
-            qsizetype haveRead = socket->read(&c, 1);
-            if (haveRead < 0)
+    while (true) {
+        const qsizetype oldSize = fragment.size();
+        const qint64 toPeek = qMin(socket->bytesAvailable(), PeekBlockSize);
+        if (toPeek <= 0)
+            break; // read more later
+
+        fragment.resize(oldSize + toPeek);
+        const qint64 peeked = socket->peek(fragment.data() + oldSize, toPeek);
+        if (peeked <= 0) {
+            fragment.truncate(oldSize);
+            if (peeked == -1)
                 return -1;
+            break; // read more later
+        }
+        fragment.truncate(oldSize + peeked);
+
+        const qsizetype lineFeed = indexOfAny(fragment, "\n", oldSize);
+        const qsizetype consumed = lineFeed == -1 ? peeked : lineFeed + 1 - oldSize;
+        socket->skip(consumed);
+        bytes += consumed;
+        if (lineFeed == -1)
+            continue;
 
-            bytes += haveRead;
-            fragment.append(c);
+        QByteArrayView line = QByteArrayView(fragment).first(lineFeed);
+        // ignore the chunk-extension
+        const qsizetype extension = indexOfAny(line, ";\r");
+        if (extension != -1)
+            line.truncate(extension);
+        line = line.trimmed();
+        if (line.isEmpty()) {
+            fragment.clear();
+            continue; // skip blank lines
         }
+
+        *chunkSize = line.toLongLong(nullptr, 16);
+        fragment.clear();
+        break; // size done
     }
 
     return bytes;
@@ -654,7 +1075,67 @@ QHttpServerRequest::~QHttpServerRequest()
 */
 QByteArray QHttpServerRequest::value(const QByteArray &key) const
 {
-    return d->parser.combinedHeaderValue(key);
+    return d->headerField(key);
+}
+
+/*!
+    Returns the number of header fields in the request, counting repeated
+    fields individually.
+
+    Unlike headers(), the raw header accessors do not copy anything out of
+    the received header block.
+
+    \since 6.10
+    \sa rawHeaderNameAt(), rawHeaderValueAt()
+*/
+qsizetype QHttpServerRequest::rawHeaderCount() const
+{
+    return d->headerFields.size();
+}
+
+/*!
+    Returns the name of the header field at position \a i, as it was
+    received. \a i must be a valid index, i.e. \c{0 <= i < rawHeaderCount()}.
+
+    The returned view stays valid as long as this request exists.
+
+    \since 6.10
+    \sa rawHeaderValueAt()
+*/
+QByteArrayView QHttpServerRequest::rawHeaderNameAt(qsizetype i) const
+{
+    Q_ASSERT(i >= 0 && i < d->headerFields.size());
+    return d->headerNameAt(i);
+}
+
+/*!
+    Returns the value of the header field at position \a i, without leading
+    and trailing whitespace. \a i must be a valid index, i.e.
+    \c{0 <= i < rawHeaderCount()}.
+
+    The returned view stays valid as long as this request exists.
+
+    \since 6.10
+    \sa rawHeaderNameAt()
+*/
+QByteArrayView QHttpServerRequest::rawHeaderValueAt(qsizetype i) const
+{
+    Q_ASSERT(i >= 0 && i < d->headerFields.size());
+    return d->headerValueAt(i);
+}
+
+/*!
+    Returns the value of the first header field called \a name, compared
+    case-insensitively, or an empty view if there is no such field. Use
+    value() to get all fields with the same name combined.
+
+    The returned view stays valid as long as this request exists.
+
+    \since 6.10
+*/
+QByteArrayView QHttpServerRequest::rawHeaderValue(QByteArrayView name) const
+{
+    return d->firstHeaderValue(name);
 }
 
 /*!
@@ -686,25 +1167,78 @@ QHttpServerRequest::Method QHttpServerRequest::method() const
     \fn QHttpHeaders QHttpServerRequest::headers() &&
 
     Returns all the request headers.
+
+    If QHttpServerConfiguration::isLazyRequestHeadersEnabled() is \c true,
+    the headers are copied out of the received header block when this
+    function is first called. It is thread-safe either way.
+
+    \sa rawHeaderValue(), value()
 */
 const QHttpHeaders &QHttpServerRequest::headers() const &
 {
-    return d->parser.headers();
+    return d->materializedHeaders();
 }
 
 QHttpHeaders QHttpServerRequest::headers() &&
 {
-    return std::move(d->parser).headers();
+    d->materializedHeaders();
+    return std::move(*d->headers);
 }
 
 /*!
     Returns the body of the request.
+
+    If the body was written to a temporary file, because it is larger than
+    QHttpServerConfiguration::requestBodyFileThreshold(), it is read from
+    the file on every call. Use bodyDevice() to read it piece by piece.
 */
 QByteArray QHttpServerRequest::body() const
 {
+    if (d->bodyFile) {
+        // Leave the position of bodyDevice() alone
+        const qint64 pos = d->bodyFile->pos();
+        d->bodyFile->seek(0);
+        const QByteArray body = d->bodyFile->readAll();
+        d->bodyFile->seek(pos);
+        return body;
+    }
     return d->body;
 }
 
+/*!
+    \since 6.10
+
+    Returns a device that reads the body of the request.
+
+    If the rule handling the request streams the body, the device is
+    sequential and delivers the body while it arrives. It emits
+    \l{QIODevice::}{readyRead()} whenever more of the body was received and
+    \l{QIODevice::}{readChannelFinished()} when the body is complete. If the
+    connection is closed before, the device is finished with an error
+    string set. If the body was written to a temporary file, the device is
+    that file, positioned at the beginning of the body. Otherwise, the
+    device reads the complete body() from memory.
+
+    The device is owned by the request and is only valid as long as the
+    request is.
+
+    \sa QHttpServerRouterRule::setStreamingBodyEnabled(),
+        QHttpServerConfiguration::setRequestBodyFileThreshold()
+*/
+QIODevice *QHttpServerRequest::bodyDevice() const
+{
+    if (d->streamingBody)
+        return d->streamingBody.get();
+    if (d->bodyFile)
+        return d->bodyFile.get();
+    if (!d->bodyReader) {
+        d->bodyReader = std::make_unique<QBuffer>();
+        d->bodyReader->setData(d->body);
+        d->bodyReader->open(QIODevice::ReadOnly);
+    }
+    return d->bodyReader.get();
+}
+
 /*!
     Returns the address of the origin host of the request.
 */
@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <QtCore/qbytearrayview.h>
 #include <QtCore/qglobal.h>
 #include <QtCore/qurl.h>
 #include <QtCore/qurlquery.h>
@@ -19,6 +20,7 @@ QT_BEGIN_NAMESPACE
 class QRegularExpression;
 class QString;
 class QHttpHeaders;
+class QIODevice;
 
 class QHttpServerRequestPrivate;
 class QHttpServerRequest final
@@ -53,12 +55,17 @@ public:
     Q_FLAG(Methods)
 
     QByteArray value(const QByteArray &key) const;
+    qsizetype rawHeaderCount() const;
+    QByteArrayView rawHeaderNameAt(qsizetype i) const;
+    QByteArrayView rawHeaderValueAt(qsizetype i) const;
+    QByteArrayView rawHeaderValue(QByteArrayView name) const;
     QUrl url() const;
     QUrlQuery query() const;
     Method method() const;
     const QHttpHeaders &headers() const &;
     QHttpHeaders headers() &&;
     QByteArray body() const;
+    QIODevice *bodyDevice() const;
     QHostAddress remoteAddress() const;
     quint16 remotePort() const;
     QHostAddress localAddress() const;
@@ -4,9 +4,18 @@
 
 #pragma once
 
+#include "qhttpserverconfiguration.h"
 #include "qhttpserverrequest.h"
-#include <QtNetwork/private/qhttpheaderparser_p.h>
-#include <QtCore/private/qbytedata_p.h>
+#include "qhttpserverresponder.h"
+#include "qhttpserverrequestbodydevice_p.h"
+#include <QtNetwork/qhttpheaders.h>
+#include <QtCore/qbuffer.h>
+#include <QtCore/qmutex.h>
+#include <QtCore/qtemporaryfile.h>
+#include <QtCore/qvarlengtharray.h>
+
+#include <memory>
+#include <optional>
 
 //
 //  W A R N I N G
@@ -46,7 +55,33 @@ public:
 
     QUrl url;
     QHttpServerRequest::Method method;
-    QHttpHeaderParser parser;
+
+    // The header fields are not copied out of the received header block,
+    // they are only indexed by their offsets into it. QHttpHeaders is built
+    // from the index once the block is complete, or, with lazyHeaders, when
+    // it is first asked for. headersMutex makes building it thread-safe.
+    struct HeaderField
+    {
+        qsizetype nameOffset;
+        qsizetype nameSize;
+        qsizetype valueOffset;
+        qsizetype valueSize;
+    };
+    QByteArray headerBlock;
+    QVarLengthArray<HeaderField, 32> headerFields;
+    mutable std::optional<QHttpHeaders> headers;
+    mutable QMutex headersMutex;
+    bool lazyHeaders = false;
+
+    bool indexHeaderBlock();
+    void appendHeaderField(QByteArrayView name, QByteArrayView value);
+    void clearHeaders();
+    QByteArrayView headerNameAt(qsizetype i) const
+    { return QByteArrayView(headerBlock).sliced(headerFields[i].nameOffset, headerFields[i].nameSize); }
+    QByteArrayView headerValueAt(qsizetype i) const
+    { return QByteArrayView(headerBlock).sliced(headerFields[i].valueOffset, headerFields[i].valueSize); }
+    QByteArrayView firstHeaderValue(QByteArrayView name) const;
+    const QHttpHeaders &materializedHeaders() const;
 
     bool parseRequestLine(QByteArrayView line);
     qsizetype readRequestLine(QIODevice *socket);
@@ -56,16 +91,24 @@ public:
     qsizetype readRequestBodyRaw(QIODevice *socket, qsizetype size);
     qsizetype readRequestBodyChunked(QIODevice *socket);
     qsizetype getChunkSize(QIODevice *socket, qsizetype *chunkSize);
+    qsizetype bodyRoom() const;
+    qsizetype readBodyData(QIODevice *socket, qsizetype size);
+    bool spillBody();
+    static std::unique_ptr<QTemporaryFile> createBodyFile();
+    void startStreamingBody();
+    bool isStreamingBody() const
+    { return streamingBody && !streamingBody->isFinished(); }
+
+    void setLimits(const QHttpServerConfiguration &configuration);
 
     bool parse(QIODevice *socket);
 #if QT_CONFIG(http)
-    bool parse(QHttp2Stream *socket);
+    bool parse(QHttp2Stream *socket, std::unique_ptr<QTemporaryFile> spilledBody = nullptr);
 #endif
     void clear();
 
     qint64 contentLength() const;
-    QByteArray headerField(const QByteArray &name) const
-    { return parser.combinedHeaderValue(name); }
+    QByteArray headerField(QByteArrayView name) const;
 
     QHostAddress remoteAddress;
     quint16 remotePort;
@@ -84,10 +127,27 @@ public:
     qsizetype currentChunkRead;
     qsizetype currentChunkSize;
     bool upgrade;
+    // Whether parse() stops before answering "Expect: 100-continue", because
+    // the responses to earlier requests are not written yet
+    bool deferContinue = false;
 
     QByteArray fragment;
-    QByteDataBuffer bodyBuffer;
     QByteArray body;
+    // The body of a request whose handler reads it while it arrives
+    std::unique_ptr<QHttpServerRequestBodyDevice> streamingBody;
+    // Limits taken from the configuration, 0 if unlimited. parse() fails
+    // with limitExceeded set when a request exceeds one.
+    qsizetype maxUrlLength = 0;
+    qsizetype maxHeaderSize = 0;
+    qsizetype maxHeaderCount = 0;
+    qint64 maxBodySize = 0;
+    std::optional<QHttpServerResponder::StatusCode> limitExceeded;
+
+    // Bodies larger than bodyFileThreshold are written to bodyFile
+    qint64 bodyFileThreshold = 0;
+    std::unique_ptr<QTemporaryFile> bodyFile;
+    // Reads the complete body, created on demand
+    mutable std::unique_ptr<QBuffer> bodyReader;
 };
 
 QT_END_NAMESPACE
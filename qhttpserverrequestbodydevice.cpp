@@ -0,0 +1,143 @@
+// Copyright (C) 2025 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+// Qt-Security score:critical reason:data-parser
+
+#include "qhttpserverrequestbodydevice_p.h"
+
+#include <limits>
+#include <utility>
+
+QT_BEGIN_NAMESPACE
+
+namespace {
+
+// How much of the body is buffered for a consumer that falls behind
+constexpr qint64 MaxBufferedBody = 1024 * 1024;
+
+} // anonymous namespace
+
+/*!
+    \internal
+    \class QHttpServerRequestBodyDevice
+
+    The body of a request whose handler reads it while it arrives. The
+    parser appends the body as it is received and stops reading from the
+    connection while the buffer is full. drained() is emitted when the
+    consumer has made room again.
+*/
+QHttpServerRequestBodyDevice::QHttpServerRequestBodyDevice(QObject *parent)
+    : QIODevice(parent)
+{
+    open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+}
+
+/*!
+    \internal
+
+    Returns how many bytes can be appended before the consumer has to catch
+    up.
+*/
+qint64 QHttpServerRequestBodyDevice::room()
+{
+    if (discarding)
+        return std::numeric_limits<qint64>::max();
+    const qint64 room = qMax(MaxBufferedBody - buffer.byteAmount(), qint64(0));
+    if (room == 0)
+        waitingForRoom = true;
+    return room;
+}
+
+/*!
+    \internal
+*/
+void QHttpServerRequestBodyDevice::append(const QByteArray &data)
+{
+    if (discarding || data.isEmpty())
+        return;
+    buffer.append(data);
+    Q_EMIT readyRead();
+}
+
+/*!
+    \internal
+
+    Marks the end of the body.
+*/
+void QHttpServerRequestBodyDevice::finish()
+{
+    if (finished)
+        return;
+    finished = true;
+    Q_EMIT readChannelFinished();
+}
+
+/*!
+    \internal
+
+    Ends the body early because the connection was closed.
+*/
+void QHttpServerRequestBodyDevice::abort()
+{
+    if (finished)
+        return;
+    setErrorString(tr("The connection was closed before the request body was complete"));
+    finish();
+}
+
+/*!
+    \internal
+
+    Drops what is buffered and everything appended later, because nobody
+    reads the body anymore.
+*/
+void QHttpServerRequestBodyDevice::discard()
+{
+    discarding = true;
+    buffer.clear();
+    if (std::exchange(waitingForRoom, false))
+        Q_EMIT drained();
+}
+
+/*!
+    \internal
+*/
+qint64 QHttpServerRequestBodyDevice::bytesAvailable() const
+{
+    return buffer.byteAmount() + QIODevice::bytesAvailable();
+}
+
+/*!
+    \internal
+*/
+bool QHttpServerRequestBodyDevice::atEnd() const
+{
+    return finished && buffer.isEmpty();
+}
+
+/*!
+    \internal
+*/
+qint64 QHttpServerRequestBodyDevice::readData(char *data, qint64 maxSize)
+{
+    if (buffer.isEmpty())
+        return finished ? -1 : 0;
+
+    const qint64 read = buffer.read(data, maxSize);
+    if (waitingForRoom && buffer.byteAmount() < MaxBufferedBody) {
+        waitingForRoom = false;
+        Q_EMIT drained();
+    }
+    return read;
+}
+
+/*!
+    \internal
+*/
+qint64 QHttpServerRequestBodyDevice::writeData(const char *data, qint64 maxSize)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(maxSize);
+    return -1;
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,56 @@
+// Copyright (C) 2025 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+// Qt-Security score:significant reason:default
+
+#pragma once
+
+#include <QtCore/qglobal.h>
+#include <QtCore/qiodevice.h>
+#include <QtCore/private/qbytedata_p.h>
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists for the convenience
+// of QHttpServer. This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+
+QT_BEGIN_NAMESPACE
+
+class QHttpServerRequestBodyDevice : public QIODevice
+{
+    Q_OBJECT
+
+public:
+    explicit QHttpServerRequestBodyDevice(QObject *parent = nullptr);
+
+    qint64 room();
+    void append(const QByteArray &data);
+    void finish();
+    void abort();
+    void discard();
+    bool isFinished() const { return finished; }
+
+    bool isSequential() const override { return true; }
+    qint64 bytesAvailable() const override;
+    bool atEnd() const override;
+
+Q_SIGNALS:
+    void drained();
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *data, qint64 maxSize) override;
+
+private:
+    QByteDataBuffer buffer;
+    bool finished = false;
+    bool discarding = false;
+    // Whether the parser stopped because the buffer was full
+    bool waitingForRoom = false;
+};
+
+QT_END_NAMESPACE
@@ -20,7 +20,15 @@ unsigned int QHttpServerRequestFilter::maxRequestPerPeriod() const
 
 void QHttpServerRequestFilter::setConfiguration(const QHttpServerConfiguration &config)
 {
+    QMutexLocker locker(&m_mutex);
     m_config = config;
+    m_generation.fetch_add(1, std::memory_order_release);
+}
+
+QHttpServerConfiguration QHttpServerRequestFilter::configuration()
+{
+    QMutexLocker locker(&m_mutex);
+    return m_config;
 }
 
 bool QHttpServerRequestFilter::isRequestWithinRate(const QHostAddress &peerAddress)
@@ -33,6 +41,7 @@ bool QHttpServerRequestFilter::isRequestWithinRate(const QHostAddress &peerAddre
 {
     using namespace QHttpServerRequestFilterPrivate;
 
+    QMutexLocker locker(&m_mutex);
     if (m_config.rateLimitPerSecond() == 0)
         return true;
 
@@ -8,8 +8,11 @@
 #include "qhttpserverconfiguration.h"
 
 #include <QtCore/qhash.h>
+#include <QtCore/qmutex.h>
 #include <QtNetwork/qhostaddress.h>
 
+#include <atomic>
+
 //
 //  W A R N I N G
 //  -------------
@@ -33,6 +36,12 @@ public:
 
     void setConfiguration(const QHttpServerConfiguration &config);
 
+    // Changes whenever the configuration is set, so that a copy of the
+    // configuration can be checked for being current without locking
+    quint32 configurationGeneration() const
+    { return m_generation.load(std::memory_order_acquire); }
+    QHttpServerConfiguration configuration();
+
     bool isRequestWithinRate(const QHostAddress &peerAddress);
     bool isRequestWithinRate(const QHostAddress &peerAddress, qint64 currTimeMSec);
 
@@ -52,7 +61,10 @@ private:
 
     unsigned maxRequestPerPeriod() const;
 
+    // Requests may be filtered from several worker threads at once
+    QMutex m_mutex;
     QHttpServerConfiguration m_config;
+    std::atomic<quint32> m_generation = 1;
     QHash<QHostAddress, IpInfo> ipInfo;
 };
 
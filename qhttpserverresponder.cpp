@@ -7,6 +7,7 @@
 #include "qhttpserverresponse.h"
 #include "qhttpserverresponder_p.h"
 #include "qhttpserverliterals_p.h"
+#include "qhttpserverrangedevice_p.h"
 #include "qhttpserverrequest_p.h"
 #include "qhttpserverresponse_p.h"
 #include "qhttpserverstream_p.h"
@@ -115,7 +116,7 @@ QHttpServerResponderPrivate::QHttpServerResponderPrivate(QHttpServerStream *stre
 QHttpServerResponderPrivate::~QHttpServerResponderPrivate()
 {
     Q_ASSERT(stream);
-    stream->responderDestroyed();
+    stream->responderDestroyed(m_streamId);
 }
 
 /*!
@@ -137,6 +138,18 @@ void QHttpServerResponderPrivate::write(const QByteArray &body, const QHttpHeade
     stream->write(body, headers, status, m_streamId);
 }
 
+/*!
+    \internal
+*/
+void QHttpServerResponderPrivate::writeSharedBody(const QByteArray &body,
+                                                  const std::shared_ptr<const void> &bodyOwner,
+                                                  const QHttpHeaders &headers,
+                                                  QHttpServerResponder::StatusCode status)
+{
+    Q_ASSERT(stream);
+    stream->writeSharedBody(body, bodyOwner, headers, status, m_streamId);
+}
+
 /*!
     \internal
 */
@@ -144,9 +157,72 @@ void QHttpServerResponderPrivate::write(QIODevice *data, const QHttpHeaders &hea
                                         QHttpServerResponder::StatusCode status)
 {
     Q_ASSERT(stream);
+    if (status == QHttpServerResponder::StatusCode::Ok && !range.isEmpty()
+        && writeRanges(data, headers)) {
+        return;
+    }
     stream->write(data, headers, status, m_streamId);
 }
 
+/*!
+    \internal
+
+    Answers a range request with the requested ranges of \a data and
+    returns \c true, or returns \c false if \a data is to be sent as a
+    whole. Only seekable devices support ranges.
+*/
+bool QHttpServerResponderPrivate::writeRanges(QIODevice *data, const QHttpHeaders &headers)
+{
+    if (headers.contains(QHttpHeaders::WellKnownHeader::ContentRange))
+        return false;
+    if (!data->isOpen() && !data->open(QIODevice::ReadOnly))
+        return false;
+    if (data->isSequential() || !(data->openMode() & QIODevice::ReadOnly))
+        return false;
+
+    // If-Range asks for the ranges only if the representation is unchanged
+    if (!ifRange.isEmpty()) {
+        const bool isEntityTag = ifRange.startsWith('"') || ifRange.startsWith("W/");
+        const QByteArrayView validator = headers.value(isEntityTag
+                ? QHttpHeaders::WellKnownHeader::ETag
+                : QHttpHeaders::WellKnownHeader::LastModified);
+        // Entity tags are compared strongly
+        if (validator != ifRange || validator.startsWith("W/"))
+            return false;
+    }
+
+    const qint64 size = data->size();
+    const auto ranges = QHttpServerRangeDevice::parseRanges(range, size);
+    if (!ranges)
+        return false;
+
+    QHttpHeaders allHeaders(headers);
+    allHeaders.replaceOrAppend(QHttpHeaders::WellKnownHeader::AcceptRanges, "bytes");
+    if (ranges->isEmpty()) {
+        data->deleteLater();
+        allHeaders.removeAll(QHttpHeaders::WellKnownHeader::ContentType);
+        allHeaders.append(QHttpHeaders::WellKnownHeader::ContentRange,
+                          "bytes */" + QByteArray::number(size));
+        allHeaders.append(QHttpHeaders::WellKnownHeader::ContentLength, "0");
+        stream->write(QByteArray(), allHeaders,
+                      QHttpServerResponder::StatusCode::RequestRangeNotSatisfiable, m_streamId);
+        return true;
+    }
+
+    auto *device = new QHttpServerRangeDevice(
+            data, *ranges, headers.value(QHttpHeaders::WellKnownHeader::ContentType).toByteArray());
+    if (device->isMultipart()) {
+        allHeaders.replaceOrAppend(QHttpHeaders::WellKnownHeader::ContentType,
+                                   device->contentType());
+    } else {
+        allHeaders.append(QHttpHeaders::WellKnownHeader::ContentRange,
+                          QHttpServerRangeDevice::contentRange(ranges->first(), size));
+    }
+    stream->write(device, allHeaders, QHttpServerResponder::StatusCode::PartialContent,
+                  m_streamId);
+    return true;
+}
+
 /*!
     \internal
 */
@@ -154,7 +230,22 @@ void QHttpServerResponderPrivate::writeBeginChunked(const QHttpHeaders &headers,
                                                     QHttpServerResponder::StatusCode status)
 {
     Q_ASSERT(stream);
-    stream->writeBeginChunked(headers, status, m_streamId);
+    if (!isCompressible(headers, status)) {
+        stream->writeBeginChunked(headers, status, m_streamId);
+        return;
+    }
+
+    QHttpHeaders allHeaders(headers);
+    auto compressor = acceptedCoding != QHttpServerCompressor::Coding::Identity
+            ? std::make_unique<QHttpServerCompressor>(acceptedCoding)
+            : nullptr;
+    if (compressor && compressor->isValid()) {
+        addCompressionHeaders(allHeaders, acceptedCoding);
+        chunkCompressor = std::move(compressor);
+    } else {
+        addCompressionHeaders(allHeaders, QHttpServerCompressor::Coding::Identity);
+    }
+    stream->writeBeginChunked(allHeaders, status, m_streamId);
 }
 
 /*!
@@ -163,6 +254,13 @@ void QHttpServerResponderPrivate::writeBeginChunked(const QHttpHeaders &headers,
 void QHttpServerResponderPrivate::writeChunk(const QByteArray &data)
 {
     Q_ASSERT(stream);
+    if (chunkCompressor) {
+        // Flushed, so that the client does not wait for the next chunk
+        const QByteArray compressed = chunkCompressor->compress(data);
+        if (!compressed.isEmpty())
+            stream->writeChunk(compressed, m_streamId);
+        return;
+    }
     stream->writeChunk(data, m_streamId);
 }
 
@@ -173,9 +271,84 @@ void QHttpServerResponderPrivate::writeEndChunked(const QByteArray &data,
                                                   const QHttpHeaders &trailers)
 {
     Q_ASSERT(stream);
+    if (chunkCompressor) {
+        const QByteArray compressed = chunkCompressor->finish(data);
+        chunkCompressor.reset();
+        stream->writeEndChunked(compressed, trailers, m_streamId);
+        return;
+    }
     stream->writeEndChunked(data, trailers, m_streamId);
 }
 
+/*!
+    \internal
+
+    Keeps what the response needs to know about \a request, and sets up its
+    compression according to \a configuration. Called by the stream before
+    the request is handled.
+*/
+void QHttpServerResponderPrivate::prepare(const QHttpServerRequest &request,
+                                          const QHttpServerConfiguration &configuration)
+{
+    // Read the fields directly, building headers() would copy all of them
+    if (request.method() == QHttpServerRequest::Method::Get) {
+        range = request.rawHeaderValue("range").toByteArray();
+        if (!range.isEmpty())
+            ifRange = request.rawHeaderValue("if-range").toByteArray();
+    }
+
+    compressionEnabled = configuration.isCompressionEnabled();
+    if (!compressionEnabled)
+        return;
+    compressionThreshold = configuration.compressionThreshold();
+    // value() combines repeated fields, like QHttpHeaders::combinedValue()
+    acceptedCoding = QHttpServerCompressor::negotiate(request.value("accept-encoding"));
+}
+
+/*!
+    \internal
+
+    Returns \c true if a response with \a headers and \a status may be
+    compressed, whether the client accepts it or not.
+*/
+bool QHttpServerResponderPrivate::isCompressible(const QHttpHeaders &headers,
+                                                 QHttpServerResponder::StatusCode status) const
+{
+    using StatusCode = QHttpServerResponder::StatusCode;
+    if (!compressionEnabled || int(status) < 200 || status == StatusCode::NoContent
+        || status == StatusCode::PartialContent || status == StatusCode::NotModified) {
+        return false;
+    }
+    return !headers.contains(QHttpHeaders::WellKnownHeader::ContentEncoding)
+            && QHttpServerCompressor::isCompressible(
+                    headers.value(QHttpHeaders::WellKnownHeader::ContentType));
+}
+
+/*!
+    \internal
+
+    Adds the headers for a response compressed with \a coding to \a headers.
+    Caches are told that compressible responses depend on
+    \c Accept-Encoding even if they are not compressed.
+*/
+void QHttpServerResponderPrivate::addCompressionHeaders(QHttpHeaders &headers,
+                                                        QHttpServerCompressor::Coding coding)
+{
+    const QByteArray vary = headers.combinedValue(QHttpHeaders::WellKnownHeader::Vary).toLower();
+    if (!vary.contains("accept-encoding") && vary.trimmed() != "*")
+        headers.append(QHttpHeaders::WellKnownHeader::Vary, "Accept-Encoding");
+    if (coding == QHttpServerCompressor::Coding::Identity)
+        return;
+
+    headers.append(QHttpHeaders::WellKnownHeader::ContentEncoding,
+                   QHttpServerCompressor::name(coding));
+    // The compressed body is a different representation, a strong entity
+    // tag of the original body no longer matches it byte for byte
+    const QByteArrayView etag = headers.value(QHttpHeaders::WellKnownHeader::ETag);
+    if (!etag.isEmpty() && !etag.startsWith("W/"))
+        headers.replaceOrAppend(QHttpHeaders::WellKnownHeader::ETag, "W/" + etag.toByteArray());
+}
+
 /*!
     Constructs a QHttpServerResponder instance using a \a stream
     to output the response to.
@@ -341,10 +514,30 @@ void QHttpServerResponder::sendResponse(const QHttpServerResponse &response)
     Q_D(QHttpServerResponder);
     const auto &r = response.d_ptr;
     QHttpHeaders allHeaders(r->headers);
+
+    if (r->data.size() >= d->compressionThreshold
+        && d->isCompressible(allHeaders, r->statusCode)) {
+        if (d->acceptedCoding != QHttpServerCompressor::Coding::Identity) {
+            const QByteArray body = QHttpServerCompressor::compressed(r->data, d->acceptedCoding);
+            if (!body.isNull() && body.size() < r->data.size()) {
+                QHttpServerResponderPrivate::addCompressionHeaders(allHeaders, d->acceptedCoding);
+                allHeaders.append(QHttpHeaders::WellKnownHeader::ContentLength,
+                                  QByteArray::number(body.size()));
+                d->write(body, allHeaders, r->statusCode);
+                return;
+            }
+        }
+        QHttpServerResponderPrivate::addCompressionHeaders(
+                allHeaders, QHttpServerCompressor::Coding::Identity);
+    }
+
     allHeaders.append(QHttpHeaders::WellKnownHeader::ContentLength,
                       QByteArray::number(r->data.size()));
 
-    d->write(r->data, allHeaders, r->statusCode);
+    if (r->dataOwner)
+        d->writeSharedBody(r->data, r->dataOwner, allHeaders, r->statusCode);
+    else
+        d->write(r->data, allHeaders, r->statusCode);
 }
 
 /*!
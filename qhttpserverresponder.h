@@ -26,6 +26,7 @@ class QHttpServerResponder final
     Q_GADGET
     Q_DECLARE_PRIVATE(QHttpServerResponder)
 
+    friend class QHttpServer;
     friend class QHttpServerHttp1ProtocolHandler;
     friend class QHttpServerHttp2ProtocolHandler;
 
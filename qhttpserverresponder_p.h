@@ -8,11 +8,15 @@
 #include "qhttpserverrequest.h"
 #include "qhttpserverresponder.h"
 
+#include "qhttpservercompressor_p.h"
+#include "qhttpserverconfiguration.h"
 #include "qhttpserverstream_p.h"
 
 #include <QtCore/qcoreapplication.h>
 #include <QtCore/qpair.h>
 #include <QtCore/qpointer.h>
+
+#include <memory>
 #include <QtCore/qsysinfo.h>
 
 #include <type_traits>
@@ -37,6 +41,8 @@ public:
 
     void write(const QByteArray &body, const QHttpHeaders &headers,
                QHttpServerResponder::StatusCode status);
+    void writeSharedBody(const QByteArray &body, const std::shared_ptr<const void> &bodyOwner,
+                         const QHttpHeaders &headers, QHttpServerResponder::StatusCode status);
     void write(QHttpServerResponder::StatusCode status);
     void write(QIODevice *data, const QHttpHeaders &headers,
                QHttpServerResponder::StatusCode status);
@@ -44,12 +50,30 @@ public:
     void writeChunk(const QByteArray &body);
     void writeEndChunked(const QByteArray &data, const QHttpHeaders &trailers);
 
+    void prepare(const QHttpServerRequest &request,
+                 const QHttpServerConfiguration &configuration);
+    bool writeRanges(QIODevice *data, const QHttpHeaders &headers);
+    bool isCompressible(const QHttpHeaders &headers,
+                        QHttpServerResponder::StatusCode status) const;
+    static void addCompressionHeaders(QHttpHeaders &headers,
+                                      QHttpServerCompressor::Coding coding);
+
 #if defined(QT_DEBUG)
     const QPointer<QHttpServerStream> stream;
 #else
     QHttpServerStream *const stream;
 #endif
     quint32 m_streamId = 0;
+
+    bool compressionEnabled = false;
+    qsizetype compressionThreshold = 0;
+    QHttpServerCompressor::Coding acceptedCoding = QHttpServerCompressor::Coding::Identity;
+    // Compresses the chunks of a chunked response
+    std::unique_ptr<QHttpServerCompressor> chunkCompressor;
+
+    // The Range and If-Range headers of a GET request
+    QByteArray range;
+    QByteArray ifRange;
 };
 
 QT_END_NAMESPACE
@@ -191,12 +191,73 @@ QHttpServerResponse QHttpServerResponse::fromFile(const QString &fileName)
     return QHttpServerResponse(mimeType, data);
 }
 
+/*!
+    \since 6.10
+
+    Returns a QHttpServerResponse with the content of the file \a fileName,
+    which is mapped into memory instead of being read.
+
+    The response body refers to the mapped pages, so sending it neither
+    copies the file to the heap nor reads it again while it is in the page
+    cache. The mapping is released when the response has been sent. If the
+    file cannot be mapped, it is read like in fromFile().
+
+    It is the caller's responsibility to sanity-check the filename, and to have
+    a well-defined policy for which files the server will request.
+
+    \note The file must not be truncated while the response exists.
+
+    \sa fromFile()
+*/
+QHttpServerResponse QHttpServerResponse::fromMappedFile(const QString &fileName)
+{
+    return fromMappedFile(fileName, QByteArray());
+}
+
+/*!
+    \since 6.10
+    \overload
+
+    Returns a QHttpServerResponse with the content of the file \a fileName,
+    which is mapped into memory, and the MIME type \a mimeType. Unlike
+    fromMappedFile(const QString &), the MIME type is not detected from the
+    content of the file, which saves time if it is already known. If
+    \a mimeType is empty, it is detected.
+*/
+QHttpServerResponse QHttpServerResponse::fromMappedFile(const QString &fileName,
+                                                        const QByteArray &mimeType)
+{
+    auto file = std::make_shared<QFile>(fileName);
+    if (!file->open(QFile::ReadOnly))
+        return QHttpServerResponse(StatusCode::NotFound);
+    const qint64 size = file->size();
+    uchar *memory = size > 0 ? file->map(0, size) : nullptr;
+    if (!memory) {
+        if (mimeType.isEmpty())
+            return fromFile(fileName);
+        return QHttpServerResponse(mimeType, file->readAll());
+    }
+
+    QByteArray data = QByteArray::fromRawData(reinterpret_cast<const char *>(memory), size);
+    QHttpServerResponse response(mimeType.isEmpty()
+            ? QMimeDatabase().mimeTypeForFileNameAndData(fileName, data).name().toLocal8Bit()
+            : mimeType,
+            std::move(data));
+    response.d_ptr->dataOwner = std::move(file);
+    return response;
+}
+
 /*!
     Returns the response body.
+
+    For a response created with fromMappedFile(), this is a copy of the
+    mapped file.
 */
 QByteArray QHttpServerResponse::data() const
 {
     Q_D(const QHttpServerResponse);
+    if (d->dataOwner)
+        return QByteArray(d->data.constData(), d->data.size());
     return d->data;
 }
 
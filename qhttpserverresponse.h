@@ -53,6 +53,9 @@ public:
 
     ~QHttpServerResponse();
     static QHttpServerResponse fromFile(const QString &fileName);
+    static QHttpServerResponse fromMappedFile(const QString &fileName);
+    static QHttpServerResponse fromMappedFile(const QString &fileName,
+                                              const QByteArray &mimeType);
 
     QByteArray data() const;
 
@@ -20,6 +20,7 @@
 #include <QtNetwork/qhttpheaders.h>
 
 #include <functional>
+#include <memory>
 #include <unordered_map>
 
 QT_BEGIN_NAMESPACE
@@ -31,6 +32,8 @@ public:
     QHttpServerResponsePrivate(const QHttpServerResponse::StatusCode sc);
 
     QByteArray data;
+    // Keeps the memory alive that data refers to, if it does not own it
+    std::shared_ptr<const void> dataOwner;
     QHttpServerResponse::StatusCode statusCode;
     QHttpHeaders headers;
 };
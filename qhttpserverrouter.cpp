@@ -7,12 +7,17 @@
 #include "qhttpserverrouter.h"
 #include "qhttpserverrouterrule.h"
 #include "qhttpserverrequest.h"
+#include "qhttpserverresponder.h"
 #include "qhttpserver.h"
 
 #include "qhttpserverrouterrule_p.h"
 
 #include <QtCore/qloggingcategory.h>
 #include <QtCore/qmetatype.h>
+#include <QtNetwork/qhttpheaders.h>
+
+#include <algorithm>
+#include <typeinfo>
 
 QT_BEGIN_NAMESPACE
 
@@ -45,6 +50,115 @@ static const QHash<QMetaType, QString> defaultConverters = {
     { QMetaType::fromType<void>(), u""_s },
 };
 
+/*!
+    \internal
+
+    Returns how a placeholder of \a type validates its segment. Must only be
+    called for the types of indexable rules, which use the default converters.
+*/
+static QHttpServerRouterSegmentKind segmentKind(QMetaType type)
+{
+    switch (type.id()) {
+    case QMetaType::Int:
+    case QMetaType::Long:
+    case QMetaType::LongLong:
+    case QMetaType::Short:
+        return QHttpServerRouterSegmentKind::Signed;
+    case QMetaType::UInt:
+    case QMetaType::ULong:
+    case QMetaType::ULongLong:
+    case QMetaType::UShort:
+        return QHttpServerRouterSegmentKind::Unsigned;
+    case QMetaType::Double:
+    case QMetaType::Float:
+        return QHttpServerRouterSegmentKind::Floating;
+    default:
+        return QHttpServerRouterSegmentKind::Any;
+    }
+}
+
+/*!
+    \internal
+
+    Returns \c true if the default converters of \a kind match all of
+    \a segment, which does not contain a '/'. Equivalent to matching the
+    regular expressions in defaultConverters, without running them.
+*/
+static bool matchesSegment(QHttpServerRouterSegmentKind kind, QStringView segment)
+{
+    const auto isDigit = [](QChar c) { return c >= u'0' && c <= u'9'; };
+    const auto skipDigits = [&](qsizetype from) {
+        while (from < segment.size() && isDigit(segment[from]))
+            ++from;
+        return from;
+    };
+
+    if (segment.isEmpty())
+        return false;
+
+    qsizetype i = 0;
+    switch (kind) {
+    case QHttpServerRouterSegmentKind::Signed:
+        if (segment[0] == u'-')
+            i = 1;
+        Q_FALLTHROUGH();
+    case QHttpServerRouterSegmentKind::Unsigned:
+        if (segment[0] == u'+')
+            i = 1;
+        return i < segment.size() && skipDigits(i) == segment.size();
+    case QHttpServerRouterSegmentKind::Floating: {
+        if (segment[0] == u'+' || segment[0] == u'-')
+            i = 1;
+        const qsizetype integral = skipDigits(i);
+        const bool hasIntegral = integral > i;
+        i = integral;
+        if (i < segment.size() && segment[i] == u'.') {
+            const qsizetype fraction = skipDigits(i + 1);
+            // ".5" and "5." are numbers, "." is not
+            if (!hasIntegral && fraction == i + 1)
+                return false;
+            i = fraction;
+        } else if (!hasIntegral) {
+            return false;
+        }
+        return i == segment.size();
+    }
+    case QHttpServerRouterSegmentKind::Any:
+        return true;
+    }
+    Q_UNREACHABLE_RETURN(false);
+}
+
+/*!
+    \internal
+
+    Returns the value of an Allow header listing \a methods.
+*/
+static QByteArray allowHeaderValue(QHttpServerRequest::Methods methods)
+{
+    static constexpr std::pair<QHttpServerRequest::Method, QByteArrayView> names[] = {
+        { QHttpServerRequest::Method::Get, "GET" },
+        { QHttpServerRequest::Method::Put, "PUT" },
+        { QHttpServerRequest::Method::Delete, "DELETE" },
+        { QHttpServerRequest::Method::Post, "POST" },
+        { QHttpServerRequest::Method::Head, "HEAD" },
+        { QHttpServerRequest::Method::Options, "OPTIONS" },
+        { QHttpServerRequest::Method::Patch, "PATCH" },
+        { QHttpServerRequest::Method::Connect, "CONNECT" },
+        { QHttpServerRequest::Method::Trace, "TRACE" },
+    };
+
+    QByteArray value;
+    for (const auto &[method, name] : names) {
+        if (!methods.testFlag(method))
+            continue;
+        if (!value.isEmpty())
+            value += ", ";
+        value += name;
+    }
+    return value;
+}
+
 /*!
     \class QHttpServerRouter
     \since 6.4
@@ -142,7 +256,295 @@ static const QHash<QMetaType, QString> defaultConverters = {
 
 QHttpServerRouterPrivate::QHttpServerRouterPrivate(QAbstractHttpServer *server)
     : converters(defaultConverters), server(server)
-{}
+{
+    pendingSnapshot.nodes.emplace_back(); // root
+    snapshotDirty.store(true, std::memory_order_release);
+}
+
+/*!
+    \internal
+
+    Returns the current snapshot of the rules, after publishing the rules
+    added since the last call. May be called from any thread.
+*/
+std::shared_ptr<const QHttpServerRouterSnapshot> QHttpServerRouterPrivate::loadSnapshot() const
+{
+    if (snapshotDirty.load(std::memory_order_acquire))
+        publishSnapshot();
+#if defined(__cpp_lib_atomic_shared_ptr)
+    return snapshot.load(std::memory_order_acquire);
+#else
+    return std::atomic_load_explicit(&snapshot, std::memory_order_acquire);
+#endif
+}
+
+/*!
+    \internal
+
+    Publishes a copy of the pending snapshot. Threads that are handling a
+    request keep using the snapshot they started with. Rules are usually
+    added before the server handles requests, so registering them costs a
+    single copy, however many there are.
+*/
+void QHttpServerRouterPrivate::publishSnapshot() const
+{
+    QMutexLocker locker(&snapshotMutex);
+    // Another thread may have published it in the meantime
+    if (!snapshotDirty.load(std::memory_order_relaxed))
+        return;
+
+    std::shared_ptr<const QHttpServerRouterSnapshot> published =
+            std::make_shared<const QHttpServerRouterSnapshot>(pendingSnapshot);
+#if defined(__cpp_lib_atomic_shared_ptr)
+    snapshot.store(std::move(published), std::memory_order_release);
+#else
+    std::atomic_store_explicit(&snapshot, std::move(published), std::memory_order_release);
+#endif
+    snapshotDirty.store(false, std::memory_order_release);
+}
+
+/*!
+    \internal
+
+    Adds \a rule after the rules that are already in the snapshot, without
+    touching them.
+*/
+void QHttpServerRouterSnapshot::append(const QHttpServerRouterRule *rule)
+{
+    const qsizetype position = qsizetype(rules.size());
+    rules.push_back(rule);
+    const QHttpServerRouterRulePrivate *rulePrivate = rule->d_func();
+    ruleMethods.push_back(rulePrivate->methods);
+    if (rulePrivate->segments.isEmpty() && !QHttpServerRouterPrivate::isPlainRule(rule))
+        anyMethodFallbackRules.push_back(position);
+    else if (rulePrivate->segments.isEmpty())
+        insertFallback(position, rulePrivate);
+    else if (rulePrivate->isLiteral())
+        insertLiteral(position, rulePrivate);
+    else
+        insert(position, rulePrivate);
+}
+
+/*!
+    \internal
+
+    Returns \c true if \a rule can be put into the routing tree, i.e. if
+    matching its path one segment at a time finds every path its regular
+    expression matches. That is the case for the plain rule class with
+    placeholders that use the default converters, none of which matches an
+    empty string or a '/'.
+*/
+bool QHttpServerRouterPrivate::isIndexable(const QHttpServerRouterRule *rule) const
+{
+    // Subclasses may match differently
+    if (!isPlainRule(rule))
+        return false;
+
+    for (const auto &segment : rule->d_func()->segments) {
+        if (!segment.type.isValid())
+            continue;
+        if (segment.type == QMetaType::fromType<QUrl>())
+            return false;
+        const auto it = defaultConverters.constFind(segment.type);
+        if (it == defaultConverters.cend() || it->isEmpty()
+            || converters.value(segment.type) != *it) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*!
+    \internal
+
+    Returns \c true if \a rule is a QHttpServerRouterRule and not a subclass
+    of it, so it matches the way QHttpServerRouterRule::matches() does.
+*/
+bool QHttpServerRouterPrivate::isPlainRule(const QHttpServerRouterRule *rule)
+{
+#if defined(__cpp_rtti)
+    return typeid(*rule) == typeid(QHttpServerRouterRule);
+#else
+    // Without RTTI, subclasses cannot be told apart
+    Q_UNUSED(rule);
+    return false;
+#endif
+}
+
+/*!
+    \internal
+
+    Adds the rule at position \a rule with the path segments of
+    \a rulePrivate to the tree.
+*/
+void QHttpServerRouterSnapshot::insert(qsizetype rule,
+                                       const QHttpServerRouterRulePrivate *rulePrivate)
+{
+    qsizetype node = 0;
+    for (const auto &segment : rulePrivate->segments) {
+        qsizetype child;
+        if (segment.type.isValid()) {
+            const size_t kind = size_t(segmentKind(segment.type));
+            child = nodes[node].placeholderChildren[kind];
+            if (child == -1) {
+                child = qsizetype(nodes.size());
+                nodes[node].placeholderChildren[kind] = child;
+                nodes.emplace_back();
+            }
+        } else {
+            auto &children = nodes[node].literalChildren;
+            auto it = std::lower_bound(children.begin(), children.end(), segment.literal,
+                                       [](const auto &entry, const QString &literal) {
+                                           return entry.first < literal;
+                                       });
+            if (it != children.end() && it->first == segment.literal) {
+                child = it->second;
+            } else {
+                child = qsizetype(nodes.size());
+                children.insert(it, { segment.literal, child });
+                nodes.emplace_back(); // invalidates children
+            }
+        }
+        node = child;
+    }
+    nodes[node].rules.push_back(rule);
+}
+
+/*!
+    \internal
+
+    Adds the rule at position \a rule, whose pattern \a rulePrivate has no
+    placeholders, to the literal rules of each of its methods.
+*/
+void QHttpServerRouterSnapshot::insertLiteral(qsizetype rule,
+                                              const QHttpServerRouterRulePrivate *rulePrivate)
+{
+    const auto methods = rulePrivate->methods & QHttpServerRequest::Method::AnyKnown;
+    for (int bit = 1; bit <= int(QHttpServerRequest::Method::AnyKnown); bit <<= 1) {
+        if (methods.testAnyFlag(QHttpServerRequest::Method(bit)))
+            literalRules[{ rulePrivate->pathPattern, bit }].push_back(rule);
+    }
+    literalPaths[rulePrivate->pathPattern].push_back(rule);
+}
+
+/*!
+    \internal
+
+    Returns the bucket of \a method, or -1 if \a method is not a single
+    known method.
+*/
+qsizetype QHttpServerRouterSnapshot::methodIndex(QHttpServerRequest::Method method)
+{
+    const quint32 bit = quint32(method);
+    if (bit == 0 || (bit & (bit - 1)) != 0
+        || !(bit & quint32(QHttpServerRequest::Method::AnyKnown))) {
+        return -1;
+    }
+    return qCountTrailingZeroBits(bit);
+}
+
+/*!
+    \internal
+
+    Adds the rule at position \a rule, which is not in the tree, to the
+    bucket of each of the methods of \a rulePrivate.
+*/
+void QHttpServerRouterSnapshot::insertFallback(qsizetype rule,
+                                               const QHttpServerRouterRulePrivate *rulePrivate)
+{
+    for (size_t i = 0; i < MethodCount; ++i) {
+        if (rulePrivate->methods.testAnyFlag(QHttpServerRequest::Method(1 << i)))
+            fallbackRules[i].push_back(rule);
+    }
+}
+
+/*!
+    \internal
+
+    Returns the positions of the rules outside of the tree that accept
+    \a method, except for the ones in anyMethodFallbackRules.
+*/
+const std::vector<qsizetype> &QHttpServerRouterSnapshot::fallbackRulesFor(
+        QHttpServerRequest::Method method) const
+{
+    static const std::vector<qsizetype> noRules;
+    const qsizetype index = methodIndex(method);
+    return index == -1 ? noRules : fallbackRules[index];
+}
+
+/*!
+    \internal
+
+    Returns the positions of the rules without placeholders whose pattern is
+    \a path and that accept \a method, or \nullptr if there are none.
+*/
+const std::vector<qsizetype> *QHttpServerRouterSnapshot::findLiteral(
+        const QString &path, QHttpServerRequest::Method method) const
+{
+    const auto it = literalRules.constFind({ path, int(method) });
+    return it == literalRules.cend() ? nullptr : &*it;
+}
+
+/*!
+    \internal
+
+    Appends the positions of the rules in the tree whose pattern matches
+    \a path and that accept \a method to \a candidates, in no particular
+    order. The positions of all rules in the tree whose pattern matches
+    \a path are appended to \a pathRules.
+*/
+void QHttpServerRouterSnapshot::collectCandidates(QStringView path,
+                                                  QHttpServerRequest::Method method,
+                                                  QVarLengthArray<qsizetype, 16> *candidates,
+                                                  QVarLengthArray<qsizetype, 16> *pathRules) const
+{
+    if (path.startsWith(u'/'))
+        collectCandidates(0, path.sliced(1), method, candidates, pathRules);
+}
+
+/*!
+    \internal
+
+    Matches the first segment of \a path against the children of \a node,
+    and the rest of the \a path recursively. A segment can match a literal
+    child and the placeholder children of several kinds. The placeholders
+    are validated here, so the regular expression of a candidate only fails
+    to match if its methods do not.
+*/
+void QHttpServerRouterSnapshot::collectCandidates(qsizetype node, QStringView path,
+                                                  QHttpServerRequest::Method method,
+                                                  QVarLengthArray<qsizetype, 16> *candidates,
+                                                  QVarLengthArray<qsizetype, 16> *pathRules) const
+{
+    const qsizetype slash = path.indexOf(u'/');
+    const QStringView segment = slash == -1 ? path : path.first(slash);
+
+    const auto visit = [&](qsizetype child) {
+        if (slash != -1) {
+            collectCandidates(child, path.sliced(slash + 1), method, candidates, pathRules);
+            return;
+        }
+        for (qsizetype rule : nodes[child].rules) {
+            pathRules->append(rule);
+            if (ruleMethods[rule].testAnyFlag(method))
+                candidates->append(rule);
+        }
+    };
+
+    const auto &children = nodes[node].literalChildren;
+    const auto it = std::lower_bound(children.cbegin(), children.cend(), segment,
+                                     [](const auto &entry, QStringView literal) {
+                                         return QStringView(entry.first) < literal;
+                                     });
+    if (it != children.cend() && QStringView(it->first) == segment)
+        visit(it->second);
+
+    for (size_t kind = 0; kind < QHttpServerRouterIndexNode::SegmentKindCount; ++kind) {
+        const qsizetype child = nodes[node].placeholderChildren[kind];
+        if (child != -1 && matchesSegment(QHttpServerRouterSegmentKind(kind), segment))
+            visit(child);
+    }
+}
 
 /*!
     Creates a QHttpServerRouter object with default converters.
@@ -247,11 +649,59 @@ QHttpServerRouterRule *QHttpServerRouter::addRuleImpl(std::unique_ptr<QHttpServe
     if (!rule->hasValidMethods() || !rule->createPathRegexp(metaTypes, d->converters)) {
         return nullptr;
     }
-    if (!d->verifyThreadAffinity(rule->contextObject())) {
+    return d->addRule(std::move(rule));
+}
+
+/*!
+    \internal
+
+    Adds \a rule like addRuleImpl(), with the path pattern already split
+    into the \a segmentCount \a segments at compile time. An empty list of
+    \a segments means the pattern cannot be matched segment by segment.
+*/
+QHttpServerRouterRule *QHttpServerRouter::addRuleImpl(std::unique_ptr<QHttpServerRouterRule> rule,
+                                                      std::initializer_list<QMetaType> metaTypes,
+                                                      const QtPrivate::HttpServerPathSegment *segments,
+                                                      qsizetype segmentCount)
+{
+    Q_D(QHttpServerRouter);
+
+    if (!rule->hasValidMethods())
         return nullptr;
-    }
 
-    return d->rules.emplace_back(std::move(rule)).get();
+    QHttpServerRouterRulePrivate *rulePrivate = rule->d_func();
+    QList<QMetaType> argumentTypes;
+    if (!rulePrivate->buildPathRegexp(metaTypes, d->converters, &argumentTypes))
+        return nullptr;
+    rulePrivate->pathRegexp.optimize();
+    rulePrivate->setSegments(segments, segmentCount, argumentTypes);
+    return d->addRule(std::move(rule));
+}
+
+/*!
+    \internal
+
+    Adds \a rule, whose path regular expression and segments are set, to
+    the pending snapshot. It is published before the next request is
+    matched. Returns the added rule or \nullptr.
+*/
+QHttpServerRouterRule *QHttpServerRouterPrivate::addRule(std::unique_ptr<QHttpServerRouterRule> rule)
+{
+    if (!verifyThreadAffinity(rule->contextObject()))
+        return nullptr;
+
+    if (!isIndexable(rule.get()))
+        rule->d_func()->segments.clear();
+
+    QHttpServerRouterRule *added = rules.emplace_back(std::move(rule)).get();
+    added->d_func()->router = this;
+    if (added->isStreamingBodyEnabled())
+        streamingRuleCount.fetch_add(1, std::memory_order_relaxed);
+
+    QMutexLocker locker(&snapshotMutex);
+    pendingSnapshot.append(added);
+    snapshotDirty.store(true, std::memory_order_release);
+    return added;
 }
 
 /*!
@@ -260,23 +710,138 @@ QHttpServerRouterRule *QHttpServerRouter::addRuleImpl(std::unique_ptr<QHttpServe
     Iterates through the list of rules to find the first that matches,
     then executes this rule, returning \c true. Returns \c false if no rule
     matches the request.
+
+    This function may be called from several threads at once. Each call
+    works on an immutable snapshot of the rules that were added before it
+    started.
+
+    The rules are indexed in a tree of path segments, so only the rules
+    whose path pattern may match the path of the \a request are tried, in
+    the order they were added. Rules without placeholders are looked up by
+    path and method, so their regular expression is only matched once they
+    are found, to fill in the match passed to their handler. Rules that do
+    not accept the method of the \a request are not tried at all.
+
+    If no rule handles the \a request, but the path of an indexed rule that
+    can be dispatched matches it, and none of these rules accepts the method
+    of the \a request, a \c{405 Method Not Allowed} response with an
+    \c Allow header listing their methods is sent, and \c true is returned.
 */
 bool QHttpServerRouter::handleRequest(const QHttpServerRequest &request,
                                       QHttpServerResponder &responder) const
 {
     Q_D(const QHttpServerRouter);
-    for (const auto &rule : d->rules) {
-        if (!rule->contextObject())
-            continue;
-        if (!d->verifyThreadAffinity(rule->contextObject()))
-            continue;
-        if (rule->exec(request, responder))
-            return true;
+    QRegularExpressionMatch match;
+    QHttpServerRequest::Methods pathMethods;
+    if (const QHttpServerRouterRule *rule = d->findRule(request, &match, &pathMethods)) {
+        rule->d_func()->callHandler(&match, request, responder);
+        return true;
+    }
+
+    if (pathMethods && !pathMethods.testAnyFlag(request.method())) {
+        qCDebug(lcRouter) << "Method" << request.method() << "not allowed for"
+                          << request.url().path();
+        QHttpHeaders headers;
+        headers.append(QHttpHeaders::WellKnownHeader::Allow, allowHeaderValue(pathMethods));
+        responder.write(headers, QHttpServerResponder::StatusCode::MethodNotAllowed);
+        return true;
     }
 
     return false;
 }
 
+/*!
+    \internal
+
+    Returns the first rule that handles \a request and stores its match in
+    \a match, or returns \c nullptr and stores the methods of the indexed
+    rules that can be dispatched and whose path matches in \a pathMethods.
+*/
+const QHttpServerRouterRule *
+QHttpServerRouterPrivate::findRule(const QHttpServerRequest &request,
+                                   QRegularExpressionMatch *match,
+                                   QHttpServerRequest::Methods *pathMethods) const
+{
+    const auto snapshot = loadSnapshot();
+    const QString path = request.url().path();
+    const QHttpServerRequest::Method method = request.method();
+
+    QVarLengthArray<qsizetype, 16> candidates;
+    QVarLengthArray<qsizetype, 16> pathRules;
+    snapshot->collectCandidates(path, method, &candidates, &pathRules);
+    std::sort(candidates.begin(), candidates.end());
+    for (const auto *fallback : { &snapshot->fallbackRulesFor(method),
+                                  &snapshot->anyMethodFallbackRules }) {
+        const qsizetype sorted = candidates.size();
+        candidates.append(fallback->data(), qsizetype(fallback->size()));
+        std::inplace_merge(candidates.begin(), candidates.begin() + sorted, candidates.end());
+    }
+
+    // The literal rules match the path, but an earlier rule takes precedence
+    static const std::vector<qsizetype> noLiteralRules;
+    const std::vector<qsizetype> *literal = snapshot->findLiteral(path, method);
+    if (!literal)
+        literal = &noLiteralRules;
+
+    auto nextLiteral = literal->cbegin();
+    auto nextCandidate = candidates.cbegin();
+    while (nextLiteral != literal->cend() || nextCandidate != candidates.cend()) {
+        const bool isLiteral = nextCandidate == candidates.cend()
+                || (nextLiteral != literal->cend() && *nextLiteral < *nextCandidate);
+        const QHttpServerRouterRule *rule =
+                snapshot->rules[isLiteral ? *nextLiteral++ : *nextCandidate++];
+        if (!isDispatchable(rule))
+            continue;
+        // Also run for literal rules, whose handlers may read the match
+        if (rule->matches(request, match))
+            return rule;
+    }
+
+    // Rules that cannot be dispatched do not make the method not allowed
+    const auto addPathMethods = [&](qsizetype position) {
+        if (isDispatchable(snapshot->rules[position]))
+            *pathMethods |= snapshot->ruleMethods[position];
+    };
+    for (qsizetype position : std::as_const(pathRules))
+        addPathMethods(position);
+    const auto literalPath = snapshot->literalPaths.constFind(path);
+    if (literalPath != snapshot->literalPaths.cend()) {
+        for (qsizetype position : *literalPath)
+            addPathMethods(position);
+    }
+
+    return nullptr;
+}
+
+/*!
+    \internal
+
+    Returns \c true if the rule that handles \a request wants to receive
+    the body while it arrives. The request is only routed if any rule does.
+*/
+bool QHttpServerRouterPrivate::streamsRequestBody(const QHttpServerRequest &request) const
+{
+    if (streamingRuleCount.load(std::memory_order_relaxed) == 0)
+        return false;
+
+    QRegularExpressionMatch match;
+    QHttpServerRequest::Methods pathMethods;
+    const QHttpServerRouterRule *rule = findRule(request, &match, &pathMethods);
+    return rule && rule->isStreamingBodyEnabled();
+}
+
+/*!
+    \internal
+
+    Returns \c true if the handler of \a rule can be called, i.e. if it has
+    one and its context object still exists in the thread of the server.
+*/
+bool QHttpServerRouterPrivate::isDispatchable(const QHttpServerRouterRule *rule) const
+{
+    return rule->contextObject() && verifyThreadAffinity(rule->contextObject())
+            && rule->d_func()->routerHandler;
+}
+
 bool QHttpServerRouterPrivate::verifyThreadAffinity(const QObject *contextObject) const
 {
     if (contextObject && (contextObject->thread() != server->thread())) {
@@ -21,6 +21,10 @@ class QHttpServerResponder;
 class QHttpServerRequest;
 class QHttpServerRouterRule;
 
+namespace QtPrivate {
+struct HttpServerPathSegment;
+}
+
 class QHttpServerRouterPrivate;
 class QHttpServerRouter
 {
@@ -75,6 +79,25 @@ private:
     QHttpServerRouterRule *addRuleImpl(std::unique_ptr<QHttpServerRouterRule> rule,
                                          std::initializer_list<QMetaType> metaTypes);
 
+    // Used by QHttpServer for path patterns that were split at compile time
+    template<typename ViewTraits, size_t ... Idx>
+    QHttpServerRouterRule *addRuleWithSegments(std::unique_ptr<QHttpServerRouterRule> rule,
+                                               const QtPrivate::HttpServerPathSegment *segments,
+                                               qsizetype segmentCount,
+                                               std::index_sequence<Idx...>)
+    {
+        return addRuleImpl(std::move(rule), {ViewTraits::Arguments::template metaType<Idx>()...},
+                           segments, segmentCount);
+    }
+
+    QHttpServerRouterRule *addRuleImpl(std::unique_ptr<QHttpServerRouterRule> rule,
+                                       std::initializer_list<QMetaType> metaTypes,
+                                       const QtPrivate::HttpServerPathSegment *segments,
+                                       qsizetype segmentCount);
+
+    friend class QHttpServer;
+    friend class QHttpServerPrivate;
+
     std::unique_ptr<QHttpServerRouterPrivate> d_ptr;
 };
 
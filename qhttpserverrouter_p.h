@@ -7,10 +7,16 @@
 #include "qhttpserverrouter.h"
 #include "qhttpserverrouterrule.h"
 
+#include <QtCore/qalgorithms.h>
 #include <QtCore/qhash.h>
+#include <QtCore/qmutex.h>
 #include <QtCore/qstring.h>
+#include <QtCore/qvarlengtharray.h>
 
+#include <array>
+#include <atomic>
 #include <memory>
+#include <utility>
 #include <vector>
 
 //
@@ -25,6 +31,66 @@
 
 QT_BEGIN_NAMESPACE
 
+class QHttpServerRouterRulePrivate;
+
+// The segments accepted by the default converter of a placeholder type
+enum class QHttpServerRouterSegmentKind {
+    Signed,
+    Unsigned,
+    Floating,
+    Any,
+};
+
+// A node of the routing tree. Each edge matches one segment of the path,
+// either literally or as a placeholder of one kind.
+struct QHttpServerRouterIndexNode
+{
+    static constexpr size_t SegmentKindCount = size_t(QHttpServerRouterSegmentKind::Any) + 1;
+
+    std::vector<std::pair<QString, qsizetype>> literalChildren; // sorted by segment
+    std::array<qsizetype, SegmentKindCount> placeholderChildren = { -1, -1, -1, -1 };
+    std::vector<qsizetype> rules; // rules whose pattern ends here
+};
+
+// Immutable state that requests are matched against. The rules are owned
+// by QHttpServerRouterPrivate::rules and live as long as the router. Rules
+// are referred to by their position in registration order.
+struct QHttpServerRouterSnapshot
+{
+    static constexpr size_t MethodCount =
+            qPopulationCount(quint32(QHttpServerRequest::Method::AnyKnown));
+
+    std::vector<const QHttpServerRouterRule *> rules;
+    std::vector<QHttpServerRequest::Methods> ruleMethods;
+    std::vector<QHttpServerRouterIndexNode> nodes; // nodes[0] is the root
+    // Rules that are not in the tree, by method. Subclasses may match any
+    // method, so they are tried for every request.
+    std::array<std::vector<qsizetype>, MethodCount> fallbackRules;
+    std::vector<qsizetype> anyMethodFallbackRules;
+    // Rules without placeholders, by path and method
+    QHash<std::pair<QString, int>, std::vector<qsizetype>> literalRules;
+    QHash<QString, std::vector<qsizetype>> literalPaths; // all methods
+
+    static qsizetype methodIndex(QHttpServerRequest::Method method);
+
+    void append(const QHttpServerRouterRule *rule);
+
+    void insertFallback(qsizetype rule, const QHttpServerRouterRulePrivate *rulePrivate);
+    const std::vector<qsizetype> &fallbackRulesFor(QHttpServerRequest::Method method) const;
+
+    void insertLiteral(qsizetype rule, const QHttpServerRouterRulePrivate *rulePrivate);
+    const std::vector<qsizetype> *findLiteral(const QString &path,
+                                              QHttpServerRequest::Method method) const;
+
+    void insert(qsizetype rule, const QHttpServerRouterRulePrivate *rulePrivate);
+    void collectCandidates(QStringView path, QHttpServerRequest::Method method,
+                           QVarLengthArray<qsizetype, 16> *candidates,
+                           QVarLengthArray<qsizetype, 16> *pathRules) const;
+    void collectCandidates(qsizetype node, QStringView path, QHttpServerRequest::Method method,
+                           QVarLengthArray<qsizetype, 16> *candidates,
+                           QVarLengthArray<qsizetype, 16> *pathRules) const;
+};
+
 class QHttpServerRouterPrivate
 {
 public:
@@ -34,7 +100,34 @@ public:
     std::vector<std::unique_ptr<QHttpServerRouterRule>> rules;
     QAbstractHttpServer *server;
 
+    // Added rules go into pendingSnapshot. It is copied and swapped in
+    // atomically before the next request is matched, so that any number
+    // of threads can handle requests without locking.
+#if defined(__cpp_lib_atomic_shared_ptr)
+    mutable std::atomic<std::shared_ptr<const QHttpServerRouterSnapshot>> snapshot;
+#else
+    mutable std::shared_ptr<const QHttpServerRouterSnapshot> snapshot;
+#endif
+    mutable QMutex snapshotMutex;
+    QHttpServerRouterSnapshot pendingSnapshot; // guarded by snapshotMutex
+    mutable std::atomic<bool> snapshotDirty = false;
+    // Rules that stream the request body, so that other requests need not
+    // be routed before their body is read
+    std::atomic<int> streamingRuleCount = 0;
+
+    QHttpServerRouterRule *addRule(std::unique_ptr<QHttpServerRouterRule> rule);
+
+    std::shared_ptr<const QHttpServerRouterSnapshot> loadSnapshot() const;
+    void publishSnapshot() const;
+
     bool verifyThreadAffinity(const QObject *contextObject) const;
+    bool isDispatchable(const QHttpServerRouterRule *rule) const;
+    const QHttpServerRouterRule *findRule(const QHttpServerRequest &request,
+                                          QRegularExpressionMatch *match,
+                                          QHttpServerRequest::Methods *pathMethods) const;
+    bool streamsRequestBody(const QHttpServerRequest &request) const;
+    static bool isPlainRule(const QHttpServerRouterRule *rule);
+    bool isIndexable(const QHttpServerRouterRule *rule) const;
 };
 
 QT_END_NAMESPACE
@@ -6,6 +6,7 @@
 #include "qhttpserverresponder.h"
 
 #include "qhttpserverrouterrule_p.h"
+#include "qhttpserverrouter_p.h"
 #include "qhttpserverrequest_p.h"
 
 #include <QtCore/qmetaobject.h>
@@ -14,6 +15,8 @@
 #include <QtCore/qstringbuilder.h>
 #include <QtCore/qdebug.h>
 
+#include <algorithm>
+
 QT_BEGIN_NAMESPACE
 
 Q_STATIC_LOGGING_CATEGORY(lcRouterRule, "qt.httpserver.router.rule")
@@ -214,6 +217,52 @@ const QObject *QHttpServerRouterRule::contextObject() const
     return d->context;
 }
 
+/*!
+    \since 6.10
+
+    Sets whether the handler of this rule receives the request body while
+    it arrives to \a enabled. The default is \c false.
+
+    A streaming rule is called as soon as the request headers are complete.
+    The body is then read from QHttpServerRequest::bodyDevice(), which emits
+    \l{QIODevice::}{readyRead()} for every piece of the body and
+    \l{QIODevice::}{readChannelFinished()} after the last one, and
+    QHttpServerRequest::body() stays empty. The server stops reading from
+    the connection while the handler falls behind, so the body is never
+    held in memory as a whole.
+
+    If the handler responds before the body is complete, the rest of the
+    body is discarded.
+
+    \note Only HTTP/1 requests are streamed. Over HTTP/2, the handler is
+    called with the complete body, which bodyDevice() reads as well.
+
+    \sa isStreamingBodyEnabled()
+*/
+void QHttpServerRouterRule::setStreamingBodyEnabled(bool enabled)
+{
+    Q_D(QHttpServerRouterRule);
+    if (d->streamingBody == enabled)
+        return;
+    d->streamingBody = enabled;
+    if (d->router)
+        d->router->streamingRuleCount.fetch_add(enabled ? 1 : -1, std::memory_order_relaxed);
+}
+
+/*!
+    \since 6.10
+
+    Returns \c true if the handler of this rule receives the request body
+    while it arrives.
+
+    \sa setStreamingBodyEnabled()
+*/
+bool QHttpServerRouterRule::isStreamingBodyEnabled() const
+{
+    Q_D(const QHttpServerRouterRule);
+    return d->streamingBody;
+}
+
 /*!
     Returns \c true if the methods is valid
 */
@@ -242,12 +291,22 @@ bool QHttpServerRouterRule::exec(const QHttpServerRequest &request,
     if (!matches(request, &match))
         return false;
 
-    void *args[] = { nullptr, &match, const_cast<QHttpServerRequest *>(&request), &responder };
-    Q_ASSERT(d->routerHandler);
-    d->routerHandler->call(nullptr, args);
+    d->callHandler(&match, request, responder);
     return true;
 }
 
+/*!
+    \internal
+*/
+void QHttpServerRouterRulePrivate::callHandler(QRegularExpressionMatch *match,
+                                               const QHttpServerRequest &request,
+                                               QHttpServerResponder &responder) const
+{
+    void *args[] = { nullptr, match, const_cast<QHttpServerRequest *>(&request), &responder };
+    Q_ASSERT(routerHandler);
+    routerHandler->call(nullptr, args);
+}
+
 /*!
     Determines whether a given \a request matches this rule.
 
@@ -276,7 +335,27 @@ bool QHttpServerRouterRule::createPathRegexp(std::initializer_list<QMetaType> me
 {
     Q_D(QHttpServerRouterRule);
 
-    QString pathRegexp = d->pathPattern;
+    QList<QMetaType> argumentTypes;
+    if (!d->buildPathRegexp(metaTypes, converters, &argumentTypes))
+        return false;
+
+    d->pathRegexp.optimize();
+    d->splitPathPattern(argumentTypes);
+    return true;
+}
+
+/*!
+    \internal
+
+    Sets the regular expression for the path pattern, replacing each
+    placeholder with the converter of the next type in \a metaTypes. The
+    types with a non-empty converter are stored in \a argumentTypes.
+*/
+bool QHttpServerRouterRulePrivate::buildPathRegexp(std::initializer_list<QMetaType> metaTypes,
+                                                   const QHash<QMetaType, QString> &converters,
+                                                   QList<QMetaType> *argumentTypes)
+{
+    QString pattern = pathPattern;
     const QLatin1StringView arg("<arg>");
     for (auto metaType : metaTypes) {
         if (metaType.id() >= QMetaType::User
@@ -297,32 +376,134 @@ bool QHttpServerRouterRule::createPathRegexp(std::initializer_list<QMetaType> me
         if (it->isEmpty())
             continue;
 
-        const auto index = pathRegexp.indexOf(arg);
+        argumentTypes->append(metaType);
+        const auto index = pattern.indexOf(arg);
         const QString &regexp = QLatin1Char('(') % *it % QLatin1Char(')');
         if (index == -1)
-            pathRegexp.append(regexp);
+            pattern.append(regexp);
         else
-            pathRegexp.replace(index, arg.size(), regexp);
+            pattern.replace(index, arg.size(), regexp);
     }
 
-    if (pathRegexp.indexOf(arg) != -1) {
+    if (pattern.indexOf(arg) != -1) {
         qCWarning(lcRouterRule) << "not enough types or one of the types is not supported, regexp:"
-                                << pathRegexp
-                                << ", pattern:" << d->pathPattern
+                                << pattern
+                                << ", pattern:" << pathPattern
                                 << ", types:" << metaTypes;
         return false;
     }
 
-    if (!pathRegexp.startsWith(QLatin1Char('^')))
-        pathRegexp = QLatin1Char('^') % pathRegexp;
-    if (!pathRegexp.endsWith(QLatin1Char('$')))
-        pathRegexp += u'$';
+    if (!pattern.startsWith(QLatin1Char('^')))
+        pattern = QLatin1Char('^') % pattern;
+    if (!pattern.endsWith(QLatin1Char('$')))
+        pattern += u'$';
 
-    qCDebug(lcRouterRule) << "url pathRegexp:" << pathRegexp;
+    qCDebug(lcRouterRule) << "url pathRegexp:" << pattern;
 
-    d->pathRegexp.setPattern(pathRegexp);
-    d->pathRegexp.optimize();
+    pathRegexp.setPattern(pattern);
     return true;
 }
 
+/*!
+    \internal
+
+    Splits the path pattern into literal segments and placeholder segments
+    of \a argumentTypes, in the same way createPathRegexp() places them.
+    Leaves the segments empty if the pattern contains regular expression
+    syntax or a placeholder that is only part of a segment, since such a
+    pattern cannot be matched one segment at a time.
+*/
+void QHttpServerRouterRulePrivate::splitPathPattern(const QList<QMetaType> &argumentTypes)
+{
+    const QLatin1StringView arg("<arg>");
+    const QLatin1StringView metaCharacters("\\^$.|?*+()[]{}");
+
+    segments.clear();
+    if (!pathPattern.startsWith(u'/'))
+        return;
+
+    QString pattern = pathPattern;
+    const qsizetype placeholders = pattern.count(arg);
+    if (argumentTypes.size() > placeholders) {
+        // The remaining argument is appended to the pattern
+        if (argumentTypes.size() - placeholders > 1 || !pattern.endsWith(u'/'))
+            return;
+        pattern += arg;
+    }
+
+    QList<Segment> result;
+    qsizetype nextArgument = 0;
+    qsizetype begin = 1;
+    while (true) {
+        const qsizetype slash = pattern.indexOf(u'/', begin);
+        const QStringView segment = slash == -1 ? QStringView(pattern).sliced(begin)
+                                                : QStringView(pattern).sliced(begin, slash - begin);
+        if (segment == arg) {
+            result.append({ QString(), argumentTypes.at(nextArgument++) });
+        } else {
+            if (segment.contains(arg))
+                return;
+            for (QChar c : segment) {
+                if (metaCharacters.contains(c))
+                    return;
+            }
+            result.append({ segment.toString(), QMetaType() });
+        }
+        if (slash == -1)
+            break;
+        begin = slash + 1;
+    }
+    segments = std::move(result);
+}
+
+/*!
+    \internal
+
+    Sets the segments from the \a count segments in \a layout, which were
+    split from the path pattern at compile time. The placeholders in
+    \a layout get the types of \a argumentTypes, and an empty last segment
+    the remaining type, if any. Leaves the segments empty if \a layout is
+    empty, i.e. the pattern cannot be matched segment by segment.
+*/
+void QHttpServerRouterRulePrivate::setSegments(const QtPrivate::HttpServerPathSegment *layout,
+                                               qsizetype count,
+                                               const QList<QMetaType> &argumentTypes)
+{
+    segments.clear();
+    const qsizetype placeholders = std::count_if(layout, layout + count, [](const auto &s) {
+        return s.placeholder;
+    });
+    if (count == 0 || argumentTypes.size() < placeholders)
+        return;
+    // The remaining argument is appended to the pattern
+    const bool appended = argumentTypes.size() > placeholders;
+    if (appended && (argumentTypes.size() - placeholders > 1 || layout[count - 1].size != 0))
+        return;
+
+    QList<Segment> result;
+    result.reserve(count);
+    qsizetype nextArgument = 0;
+    for (qsizetype i = 0; i < count; ++i) {
+        if (layout[i].placeholder || (appended && i == count - 1))
+            result.append({ QString(), argumentTypes.at(nextArgument++) });
+        else
+            result.append({ pathPattern.sliced(layout[i].offset, layout[i].size), QMetaType() });
+    }
+    segments = std::move(result);
+}
+
+/*!
+    \internal
+
+    Returns \c true if the pattern has no placeholders and no regular
+    expression syntax, i.e. it only matches a path equal to the pattern.
+*/
+bool QHttpServerRouterRulePrivate::isLiteral() const
+{
+    if (segments.isEmpty())
+        return false;
+    return std::none_of(segments.cbegin(), segments.cend(),
+                        [](const Segment &segment) { return segment.type.isValid(); });
+}
+
 QT_END_NAMESPACE
@@ -11,11 +11,145 @@
 #include <QtCore/qcontainerfwd.h>
 #include <QtCore/qregularexpression.h>
 
+#include <array>
 #include <initializer_list>
 #include <memory>
 
 QT_BEGIN_NAMESPACE
 
+namespace QtPrivate {
+
+// A segment of a path pattern between two '/'. A placeholder segment is
+// "<arg>"; the text of any other segment is matched literally.
+struct HttpServerPathSegment
+{
+    qsizetype offset;
+    qsizetype size;
+    bool placeholder;
+};
+
+#if defined(__cpp_nontype_template_args) && __cpp_nontype_template_args >= 201911L
+#  define QT_HTTPSERVER_HAS_PATH_PATTERN_LITERALS
+
+// A path pattern given as a template argument, so that it is checked and
+// split into segments at compile time.
+template <size_t N>
+struct HttpServerPathPattern
+{
+    char text[N] = {};
+
+    constexpr HttpServerPathPattern(const char (&pattern)[N])
+    {
+        for (size_t i = 0; i < N; ++i)
+            text[i] = pattern[i];
+    }
+
+    static constexpr qsizetype size() { return qsizetype(N) - 1; }
+
+    QString toString() const { return QString::fromUtf8(text, size()); }
+
+    constexpr bool isAscii() const
+    {
+        for (qsizetype i = 0; i < size(); ++i) {
+            if (static_cast<unsigned char>(text[i]) >= 0x80)
+                return false;
+        }
+        return true;
+    }
+
+    constexpr bool isPlaceholderAt(qsizetype i) const
+    {
+        constexpr char arg[] = "<arg>";
+        if (i + 5 > size())
+            return false;
+        for (qsizetype j = 0; j < 5; ++j) {
+            if (text[i + j] != arg[j])
+                return false;
+        }
+        return true;
+    }
+
+    constexpr qsizetype placeholderCount() const
+    {
+        qsizetype count = 0;
+        for (qsizetype i = 0; i < size(); ++i) {
+            if (isPlaceholderAt(i))
+                ++count;
+        }
+        return count;
+    }
+
+    // Whether the pattern accepts the given number of captured arguments.
+    // Like QHttpServerRouterRulePrivate::buildPathRegexp(), an argument
+    // without a placeholder is appended, which only makes sense for a
+    // single argument after a trailing '/'.
+    constexpr bool acceptsArgumentCount(qsizetype count) const
+    {
+        const qsizetype placeholders = placeholderCount();
+        if (placeholders == count)
+            return true;
+        return placeholders + 1 == count && size() > 0 && text[size() - 1] == '/';
+    }
+
+    // Whether the pattern can be matched one segment at a time. Follows
+    // QHttpServerRouterRulePrivate::splitPathPattern().
+    constexpr bool isSegmentable() const
+    {
+        constexpr char metaCharacters[] = "\\^$.|?*+()[]{}";
+        if (size() == 0 || text[0] != '/')
+            return false;
+
+        qsizetype begin = 1;
+        for (qsizetype i = 1; i <= size(); ++i) {
+            if (i < size() && text[i] != '/') {
+                for (char c : metaCharacters) {
+                    if (c != '\0' && text[i] == c)
+                        return false;
+                }
+                continue;
+            }
+            const bool placeholder = i - begin == 5 && isPlaceholderAt(begin);
+            for (qsizetype j = begin; !placeholder && j < i; ++j) {
+                if (isPlaceholderAt(j))
+                    return false;
+            }
+            begin = i + 1;
+        }
+        return true;
+    }
+
+    constexpr qsizetype segmentCount() const
+    {
+        if (!isSegmentable())
+            return 0;
+        qsizetype count = 0;
+        for (qsizetype i = 0; i < size(); ++i) {
+            if (text[i] == '/')
+                ++count;
+        }
+        return count;
+    }
+
+    template <qsizetype Count>
+    constexpr std::array<HttpServerPathSegment, Count> segments() const
+    {
+        std::array<HttpServerPathSegment, Count> result = {};
+        qsizetype next = 0;
+        qsizetype begin = 1;
+        for (qsizetype i = 1; next < Count && i <= size(); ++i) {
+            if (i < size() && text[i] != '/')
+                continue;
+            result[next++] = { begin, i - begin, i - begin == 5 && isPlaceholderAt(begin) };
+            begin = i + 1;
+        }
+        return result;
+    }
+};
+
+#endif
+
+} // namespace QtPrivate
+
 class QString;
 class QHttpServerRequest;
 class QHttpServerResponder;
@@ -97,6 +231,9 @@ public:
 
     const QObject *contextObject() const;
 
+    void setStreamingBodyEnabled(bool enabled);
+    bool isStreamingBodyEnabled() const;
+
     virtual ~QHttpServerRouterRule();
 
 protected:
@@ -135,21 +272,56 @@ protected:
         if constexpr (std::is_member_function_pointer_v<ViewHandler>) {
             return bind_front(
                 handler, const_cast<typename QtPrivate::ContextTypeForFunctor<ViewHandler>::ContextType*>(context),
-                QVariant(match.captured(Cx + 1))
-                        .value<typename ViewTraits::Arguments::template Arg<Cx>::CleanType>()...);
+                convertCaptured<typename ViewTraits::Arguments::template Arg<Cx>::CleanType>(
+                        match, int(Cx + 1))...);
         } else {
             Q_UNUSED(context);
             return bind_front(
                     handler,
-                    QVariant(match.captured(Cx + 1))
-                            .value<typename ViewTraits::Arguments::template Arg<Cx>::CleanType>()...);
+                    convertCaptured<typename ViewTraits::Arguments::template Arg<Cx>::CleanType>(
+                            match, int(Cx + 1))...);
         }
     }
 
+    // Converts the types of the default converters straight from the
+    // captured text, and any other type through QVariant.
+    template<typename T>
+    static T convertCaptured(const QRegularExpressionMatch &match, int index)
+    {
+        const QStringView captured = match.capturedView(index);
+        if constexpr (std::is_same_v<T, QString>)
+            return captured.toString();
+        else if constexpr (std::is_same_v<T, QByteArray>)
+            return captured.toUtf8();
+        else if constexpr (std::is_same_v<T, short>)
+            return captured.toShort();
+        else if constexpr (std::is_same_v<T, unsigned short>)
+            return captured.toUShort();
+        else if constexpr (std::is_same_v<T, int>)
+            return captured.toInt();
+        else if constexpr (std::is_same_v<T, unsigned int>)
+            return captured.toUInt();
+        else if constexpr (std::is_same_v<T, long>)
+            return captured.toLong();
+        else if constexpr (std::is_same_v<T, unsigned long>)
+            return captured.toULong();
+        else if constexpr (std::is_same_v<T, long long>)
+            return captured.toLongLong();
+        else if constexpr (std::is_same_v<T, unsigned long long>)
+            return captured.toULongLong();
+        else if constexpr (std::is_same_v<T, float>)
+            return captured.toFloat();
+        else if constexpr (std::is_same_v<T, double>)
+            return captured.toDouble();
+        else
+            return QVariant(captured.toString()).value<T>();
+    }
+
 private:
     std::unique_ptr<QHttpServerRouterRulePrivate> d_ptr;
 
     friend class QHttpServerRouter;
+    friend class QHttpServerRouterPrivate;
 };
 
 QT_END_NAMESPACE
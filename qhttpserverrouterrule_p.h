@@ -6,6 +6,9 @@
 
 #include "qhttpserverrouterrule.h"
 
+#include <QtCore/qhash.h>
+#include <QtCore/qlist.h>
+#include <QtCore/qmetatype.h>
 #include <QtCore/qregularexpression.h>
 #include <QtCore/qstring.h>
 #include <QtCore/qpointer.h>
@@ -22,6 +25,8 @@
 
 QT_BEGIN_NAMESPACE
 
+class QHttpServerRouterPrivate;
+
 class QHttpServerRouterRulePrivate
 {
 public:
@@ -29,8 +34,30 @@ public:
     QHttpServerRequest::Methods methods;
     QtPrivate::SlotObjUniquePtr routerHandler;
     QPointer<const QObject> context;
+    bool streamingBody = false;
+    QHttpServerRouterPrivate *router = nullptr; // set when the rule is added
 
     QRegularExpression pathRegexp;
+
+    // The path pattern split at '/', used by QHttpServerRouter to index the
+    // rule. A segment with a valid type is a placeholder. Empty if the
+    // pattern cannot be matched segment by segment.
+    struct Segment
+    {
+        QString literal;
+        QMetaType type;
+    };
+    QList<Segment> segments;
+
+    bool buildPathRegexp(std::initializer_list<QMetaType> metaTypes,
+                         const QHash<QMetaType, QString> &converters,
+                         QList<QMetaType> *argumentTypes);
+    void splitPathPattern(const QList<QMetaType> &argumentTypes);
+    void setSegments(const QtPrivate::HttpServerPathSegment *layout, qsizetype count,
+                     const QList<QMetaType> &argumentTypes);
+    bool isLiteral() const;
+    void callHandler(QRegularExpressionMatch *match, const QHttpServerRequest &request,
+                     QHttpServerResponder &responder) const;
 };
 
 QT_END_NAMESPACE
@@ -0,0 +1,671 @@
+// Copyright (C) 2025 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+// Qt-Security score:critical reason:data-parser
+
+#include "qhttpserverstaticdirectory_p.h"
+
+#include "qhttpservercompressor_p.h"
+#include "qhttpserverrequest.h"
+#include "qhttpserverresponder.h"
+#include "qhttpserverresponse.h"
+
+#include <QtCore/qfile.h>
+#include <QtCore/qfileinfo.h>
+#include <QtCore/qlocale.h>
+#include <QtCore/qloggingcategory.h>
+#include <QtCore/qmimedatabase.h>
+
+QT_BEGIN_NAMESPACE
+
+Q_STATIC_LOGGING_CATEGORY(lcHttpServerStaticDirectory, "qt.httpserver.staticdirectory")
+
+using namespace Qt::StringLiterals;
+
+namespace {
+
+struct QHttpServerPrecompressedVariant
+{
+    QByteArrayView coding;
+    QLatin1StringView suffix;
+};
+
+// Sorted by preference
+constexpr QHttpServerPrecompressedVariant precompressedVariants[] = {
+    { "br", ".br"_L1 },
+    { "zstd", ".zst"_L1 },
+    { "gzip", ".gz"_L1 },
+};
+
+QLatin1StringView suffixFor(QByteArrayView coding)
+{
+    for (const auto &variant : precompressedVariants) {
+        if (variant.coding == coding)
+            return variant.suffix;
+    }
+    Q_UNREACHABLE_RETURN(QLatin1StringView());
+}
+
+} // anonymous namespace
+
+/*!
+    \class QHttpServerStaticDirectory
+    \since 6.10
+    \inmodule QtHttpServer
+    \brief The QHttpServerStaticDirectory class serves the files of a
+    directory.
+
+    QHttpServerStaticDirectory answers requests for the files below
+    rootPath(). Small files are kept in memory together with their MIME type
+    and validators, so that serving them again does not touch the disk. For
+    larger files, only the MIME type and validators are kept.
+    Every response carries a strong \c ETag and a \c Last-Modified header,
+    and conditional requests that match them are answered with
+    QHttpServerResponder::StatusCode::NotModified.
+
+    If precompressed variants are enabled, a file such as \c{app.js} can be
+    sent as its sibling \c{app.js.br}, \c{app.js.zst} or \c{app.js.gz},
+    whichever content coding the \c Accept-Encoding header of the request
+    prefers, so that the server does not spend time compressing responses.
+
+    Cached files are watched with QFileSystemWatcher and dropped from the
+    cache when they change. The watcher lives in the thread that creates the
+    QHttpServerStaticDirectory, which must run an event loop.
+
+    \code
+    QHttpServer server;
+    QHttpServerStaticDirectory assets(u"/srv/www"_s);
+    server.route("/assets/<arg>", [&assets](const QUrl &path,
+                                            const QHttpServerRequest &request) {
+        return assets.response(request, path.path());
+    });
+    \endcode
+
+    Handlers that take a QHttpServerResponder can use sendResponse()
+    instead, which sends files that are too large to be cached directly
+    from the disk and answers range requests for them.
+
+    response() is thread-safe, the same QHttpServerStaticDirectory can serve
+    requests handled in several threads.
+*/
+
+/*!
+    \internal
+*/
+QHttpServerStaticDirectoryPrivate::QHttpServerStaticDirectoryPrivate(const QString &rootPath)
+    : root(QFileInfo(rootPath).canonicalFilePath()),
+      cache(32 * 1024 * 1024)
+{
+    if (root.isEmpty())
+        qCWarning(lcHttpServerStaticDirectory, "%ls does not exist", qUtf16Printable(rootPath));
+    QObject::connect(&watcher, &QFileSystemWatcher::fileChanged, &watcher,
+                     [this](const QString &path) { invalidate(path); });
+}
+
+/*!
+    \internal
+
+    Returns \a path relative to the root without empty and \c{.} segments, or
+    an empty string if \a path could leave the root.
+*/
+QString QHttpServerStaticDirectoryPrivate::cleanPath(QStringView path)
+{
+    QString result;
+    for (QStringView segment : qTokenize(path, u'/', Qt::SkipEmptyParts)) {
+        if (segment == u".")
+            continue;
+        if (segment == u".." || segment.contains(u'\\') || segment.contains(QChar::Null))
+            return QString();
+        if (!result.isEmpty())
+            result += u'/';
+        result += segment;
+    }
+    return result;
+}
+
+/*!
+    \internal
+
+    Returns a strong entity tag built from the modification time and the
+    size of a file, which does not require hashing its content. Variants
+    with the content coding \a encoding get a tag of their own.
+*/
+QByteArray QHttpServerStaticDirectoryPrivate::etagFor(const QDateTime &modified, qint64 size,
+                                                      QByteArrayView encoding)
+{
+    QByteArray etag = '"' + QByteArray::number(modified.toMSecsSinceEpoch(), 16) + '-'
+            + QByteArray::number(size, 16);
+    if (!encoding.isEmpty()) {
+        etag += '-';
+        etag += encoding;
+    }
+    return etag + '"';
+}
+
+/*!
+    \internal
+*/
+QByteArray QHttpServerStaticDirectoryPrivate::httpDate(const QDateTime &dateTime)
+{
+    return QLocale::c().toString(dateTime.toUTC(), u"ddd, dd MMM yyyy hh:mm:ss 'GMT'").toLatin1();
+}
+
+/*!
+    \internal
+
+    Returns the content coding of \a encodings that \a acceptEncoding gives
+    the highest quality, or an empty array if the file should be sent as is.
+    \a encodings are sorted by preference, which breaks ties.
+*/
+QByteArray QHttpServerStaticDirectoryPrivate::negotiateEncoding(
+        QByteArrayView acceptEncoding, const QList<QByteArray> &encodings)
+{
+    QByteArray best;
+    int bestQuality = 0;
+    for (const QByteArray &encoding : encodings) {
+        const int q = QHttpServerCompressor::quality(acceptEncoding, encoding);
+        if (q > bestQuality) {
+            best = encoding;
+            bestQuality = q;
+        }
+    }
+    if (!best.isEmpty()
+        && QHttpServerCompressor::quality(acceptEncoding, "identity") > bestQuality) {
+        return QByteArray();
+    }
+    return best;
+}
+
+/*!
+    \internal
+
+    Returns \c true if the validators of \a request match \a entry. As
+    specified by RFC 9110, \c If-Modified-Since is ignored if the request has
+    an \c If-None-Match header.
+*/
+bool QHttpServerStaticDirectoryPrivate::isNotModified(const QHttpServerRequest &request,
+                                                      const Entry &entry)
+{
+    const auto method = request.method();
+    if (method != QHttpServerRequest::Method::Get && method != QHttpServerRequest::Method::Head)
+        return false;
+
+    // The raw accessors do not copy all fields of the request like headers()
+    const QByteArray value = request.value("if-none-match");
+    if (!value.isEmpty()) {
+        for (const QByteArray &tag : value.split(',')) {
+            QByteArrayView candidate = QByteArrayView(tag).trimmed();
+            if (candidate == "*")
+                return true;
+            // If-None-Match uses the weak comparison
+            if (candidate.startsWith("W/"))
+                candidate = candidate.sliced(2);
+            if (candidate == entry.etag)
+                return true;
+        }
+        return false;
+    }
+
+    const QByteArrayView since = request.rawHeaderValue("if-modified-since");
+    if (since.isEmpty())
+        return false;
+    // Clients usually send back the Last-Modified value they got
+    if (since == entry.lastModified)
+        return true;
+    const QDateTime sinceDateTime = QDateTime::fromString(QString::fromLatin1(since),
+                                                          Qt::RFC2822Date);
+    return sinceDateTime.isValid()
+            && entry.modified.toSecsSinceEpoch() <= sinceDateTime.toSecsSinceEpoch();
+}
+
+/*!
+    \internal
+
+    Adds the validators of \a entry to \a headers, and its content type and
+    coding if \a withContent is \c true. If \a vary is \c true, caches are
+    told that the response depends on \c Accept-Encoding.
+*/
+void QHttpServerStaticDirectoryPrivate::appendHeaders(QHttpHeaders &headers, const Entry &entry,
+                                                      bool vary, bool withContent)
+{
+    if (withContent) {
+        headers.replaceOrAppend(QHttpHeaders::WellKnownHeader::ContentType, entry.mimeType);
+        if (!entry.encoding.isEmpty())
+            headers.append(QHttpHeaders::WellKnownHeader::ContentEncoding, entry.encoding);
+    }
+    headers.append(QHttpHeaders::WellKnownHeader::ETag, entry.etag);
+    headers.append(QHttpHeaders::WellKnownHeader::LastModified, entry.lastModified);
+    if (vary)
+        headers.append(QHttpHeaders::WellKnownHeader::Vary, "Accept-Encoding");
+}
+
+/*!
+    \internal
+
+    Adds the headers of \a entry to \a response, without its content type
+    and coding if \a response is a 304.
+*/
+void QHttpServerStaticDirectoryPrivate::addHeaders(QHttpServerResponse &response,
+                                                   const Entry &entry, bool vary)
+{
+    QHttpHeaders headers = response.headers();
+    appendHeaders(headers, entry, vary,
+                  response.statusCode() != QHttpServerResponse::StatusCode::NotModified);
+    response.setHeaders(std::move(headers));
+}
+
+/*!
+    \internal
+*/
+QHttpServerResponse QHttpServerStaticDirectoryPrivate::responseFor(
+        const QHttpServerRequest &request, const Entry &entry, bool vary)
+{
+    if (isNotModified(request, entry)) {
+        QHttpServerResponse response(QByteArray(), QByteArray(),
+                                     QHttpServerResponse::StatusCode::NotModified);
+        addHeaders(response, entry, vary);
+        return response;
+    }
+
+    QHttpServerResponse response = entry.filePath.isEmpty()
+            ? QHttpServerResponse(entry.mimeType, QByteArray(entry.data))
+            : QHttpServerResponse::fromMappedFile(entry.filePath, entry.mimeType);
+    if (response.statusCode() == QHttpServerResponse::StatusCode::Ok)
+        addHeaders(response, entry, vary);
+    return response;
+}
+
+/*!
+    \internal
+*/
+bool QHttpServerStaticDirectoryPrivate::isFileInRoot(const QFileInfo &info) const
+{
+    return info.isFile() && info.canonicalFilePath().startsWith(root + u'/');
+}
+
+/*!
+    \internal
+
+    Returns the file \a key, or its precompressed variant with the content
+    coding \a encoding, from the cache or from the disk, and adds it to the
+    cache. The content is only cached for files that are small enough. If
+    \a mimeType is empty, the MIME type is detected from the file.
+*/
+std::optional<QHttpServerStaticDirectoryPrivate::Entry>
+QHttpServerStaticDirectoryPrivate::find(const QString &key, const QByteArray &encoding,
+                                        const QByteArray &mimeType) const
+{
+    const QString cacheKey = encoding.isEmpty()
+            ? key : key + QChar::Null + QLatin1StringView(encoding);
+
+    QMutexLocker locker(&mutex);
+    if (const Entry *cached = cache.object(cacheKey))
+        return *cached;
+    const qsizetype maxSize = maxFileSize;
+    const bool withVariants = precompressed && encoding.isEmpty();
+    locker.unlock();
+
+    const QString relativePath = encoding.isEmpty() ? key : key + suffixFor(encoding);
+    const QFileInfo info(filePath(relativePath));
+    if (!isFileInRoot(info))
+        return std::nullopt;
+
+    Entry entry;
+    entry.modified = info.lastModified().toUTC();
+    entry.size = info.size();
+    entry.lastModified = httpDate(entry.modified);
+    entry.encoding = encoding;
+    if (withVariants) {
+        for (const auto &variant : precompressedVariants) {
+            if (isFileInRoot(QFileInfo(filePath(key + variant.suffix))))
+                entry.encodings.append(variant.coding.toByteArray());
+        }
+    }
+
+    if (entry.size > maxSize) {
+        entry.etag = etagFor(entry.modified, entry.size, encoding);
+        entry.mimeType = mimeType.isEmpty()
+                ? QMimeDatabase().mimeTypeForFile(info).name().toLocal8Bit() : mimeType;
+        entry.filePath = info.filePath();
+    } else {
+        QFile file(info.filePath());
+        if (!file.open(QFile::ReadOnly))
+            return std::nullopt;
+        entry.data = file.readAll();
+        file.close();
+        entry.size = entry.data.size();
+        entry.etag = etagFor(entry.modified, entry.size, encoding);
+        entry.mimeType = mimeType.isEmpty()
+                ? QMimeDatabase().mimeTypeForFileNameAndData(info.filePath(), entry.data)
+                          .name().toLocal8Bit()
+                : mimeType;
+    }
+
+    locker.relock();
+    const bool cached = cache.insert(cacheKey, new Entry(entry), qMax(entry.data.size(), 1));
+    locker.unlock();
+    if (cached)
+        watch(cacheKey, relativePath);
+    return entry;
+}
+
+/*!
+    \internal
+
+    Returns the file at \a path to answer \a request with, or its
+    precompressed variant that the request accepts best. \a vary is set if
+    the file has variants.
+*/
+std::optional<QHttpServerStaticDirectoryPrivate::Entry>
+QHttpServerStaticDirectoryPrivate::select(const QHttpServerRequest &request, QStringView path,
+                                          bool *vary) const
+{
+    const QString key = cleanPath(path);
+    if (key.isEmpty() || root.isEmpty())
+        return std::nullopt;
+
+    auto identity = find(key, QByteArray(), QByteArray());
+    if (!identity)
+        return std::nullopt;
+
+    *vary = !identity->encodings.isEmpty();
+    if (*vary) {
+        const QByteArray encoding =
+                negotiateEncoding(request.value("accept-encoding"), identity->encodings);
+        if (!encoding.isEmpty()) {
+            // The variant might have been removed in the meantime
+            if (auto variant = find(key, encoding, identity->mimeType))
+                return variant;
+        }
+    }
+    return identity;
+}
+
+/*!
+    \internal
+
+    Returns \c true if the file at \a relativePath is cached, either as is or
+    as a precompressed variant. Must be called with the mutex locked.
+*/
+bool QHttpServerStaticDirectoryPrivate::isCached(const QString &relativePath) const
+{
+    if (cache.contains(relativePath))
+        return true;
+    for (const auto &variant : precompressedVariants) {
+        if (relativePath.endsWith(variant.suffix)
+            && cache.contains(relativePath.chopped(variant.suffix.size()) + QChar::Null
+                              + QLatin1StringView(variant.coding))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*!
+    \internal
+
+    Starts watching the file at \a relativePath, cached as \a cacheKey. The
+    file is dropped from the cache if it cannot be watched or if it changed
+    before it was watched.
+*/
+void QHttpServerStaticDirectoryPrivate::watch(const QString &cacheKey,
+                                              const QString &relativePath) const
+{
+    QMetaObject::invokeMethod(&watcher, [this, cacheKey, relativePath] {
+        const QString path = filePath(relativePath);
+        bool isWatched = watched.contains(relativePath);
+        if (!isWatched && watcher.addPath(path)) {
+            watched.insert(relativePath);
+            isWatched = true;
+        }
+
+        const QFileInfo info(path);
+        QMutexLocker locker(&mutex);
+        if (const Entry *entry = cache.object(cacheKey)) {
+            if (!isWatched || info.lastModified().toUTC() != entry->modified
+                || info.size() != entry->size) {
+                qCDebug(lcHttpServerStaticDirectory, "Not caching %ls", qUtf16Printable(path));
+                cache.remove(cacheKey);
+            }
+        }
+
+        // Stop watching the files that were evicted from the cache
+        if (watched.size() > 2 * cache.count() + 16) {
+            for (auto it = watched.begin(); it != watched.end();) {
+                if (isCached(*it)) {
+                    ++it;
+                } else {
+                    watcher.removePath(filePath(*it));
+                    it = watched.erase(it);
+                }
+            }
+        }
+    });
+}
+
+/*!
+    \internal
+
+    Drops the file at \a path from the cache. If it is a precompressed
+    variant, the file it belongs to is dropped as well, because the list of
+    its variants might be outdated.
+*/
+void QHttpServerStaticDirectoryPrivate::invalidate(const QString &path)
+{
+    const QString relativePath = path.sliced(root.size() + 1);
+    qCDebug(lcHttpServerStaticDirectory, "%ls changed", qUtf16Printable(path));
+    {
+        QMutexLocker locker(&mutex);
+        cache.remove(relativePath);
+        for (const auto &variant : precompressedVariants) {
+            if (relativePath.endsWith(variant.suffix)) {
+                const QString key = relativePath.chopped(variant.suffix.size());
+                cache.remove(key);
+                cache.remove(key + QChar::Null + QLatin1StringView(variant.coding));
+            }
+        }
+    }
+    // Files are often replaced rather than modified, so watch them again
+    // when they are cached the next time
+    watcher.removePath(path);
+    watched.remove(relativePath);
+}
+
+/*!
+    Creates a QHttpServerStaticDirectory serving the files below
+    \a rootPath.
+*/
+QHttpServerStaticDirectory::QHttpServerStaticDirectory(const QString &rootPath)
+    : d_ptr(new QHttpServerStaticDirectoryPrivate(rootPath))
+{
+}
+
+/*!
+    Destroys the QHttpServerStaticDirectory.
+*/
+QHttpServerStaticDirectory::~QHttpServerStaticDirectory()
+    = default;
+
+/*!
+    Returns the canonical path of the directory whose files are served, or
+    an empty string if it does not exist.
+*/
+QString QHttpServerStaticDirectory::rootPath() const
+{
+    Q_D(const QHttpServerStaticDirectory);
+    return d->root;
+}
+
+/*!
+    Sets the maximum number of \a bytes used to cache file contents. The
+    least recently used files are dropped first. The default is 32 MiB.
+
+    \sa cacheSize(), setMaxCachedFileSize()
+*/
+void QHttpServerStaticDirectory::setCacheSize(qsizetype bytes)
+{
+    Q_D(QHttpServerStaticDirectory);
+    QMutexLocker locker(&d->mutex);
+    d->cache.setMaxCost(bytes);
+}
+
+/*!
+    Returns the maximum number of bytes used to cache file contents.
+
+    \sa setCacheSize()
+*/
+qsizetype QHttpServerStaticDirectory::cacheSize() const
+{
+    Q_D(const QHttpServerStaticDirectory);
+    QMutexLocker locker(&d->mutex);
+    return d->cache.maxCost();
+}
+
+/*!
+    Sets the size in \a bytes of the largest file whose content is cached.
+    Larger files are mapped into memory on every request instead, only their
+    MIME type and validators are cached. The default is 1 MiB.
+
+    \sa maxCachedFileSize(), QHttpServerResponse::fromMappedFile()
+*/
+void QHttpServerStaticDirectory::setMaxCachedFileSize(qsizetype bytes)
+{
+    Q_D(QHttpServerStaticDirectory);
+    QMutexLocker locker(&d->mutex);
+    if (d->maxFileSize == bytes)
+        return;
+    d->maxFileSize = bytes;
+    d->cache.clear();
+}
+
+/*!
+    Returns the size in bytes of the largest file that is cached.
+
+    \sa setMaxCachedFileSize()
+*/
+qsizetype QHttpServerStaticDirectory::maxCachedFileSize() const
+{
+    Q_D(const QHttpServerStaticDirectory);
+    QMutexLocker locker(&d->mutex);
+    return d->maxFileSize;
+}
+
+/*!
+    Sets whether precompressed variants of the files are sent to the clients
+    that accept them to \a enabled. The variants are the siblings of a file
+    with the suffix \c{.br}, \c{.zst} or \c{.gz}, sent with the
+    \c Content-Encoding \c br, \c zstd or \c gzip. The variants of a file
+    are looked up when the file is added to the cache. Responses for files
+    that have variants carry a \c{Vary: Accept-Encoding} header.
+
+    Precompressed variants are disabled by default.
+
+    \sa isPrecompressedVariantsEnabled()
+*/
+void QHttpServerStaticDirectory::setPrecompressedVariantsEnabled(bool enabled)
+{
+    Q_D(QHttpServerStaticDirectory);
+    QMutexLocker locker(&d->mutex);
+    if (d->precompressed == enabled)
+        return;
+    d->precompressed = enabled;
+    d->cache.clear();
+}
+
+/*!
+    Returns whether precompressed variants of the files are sent.
+
+    \sa setPrecompressedVariantsEnabled()
+*/
+bool QHttpServerStaticDirectory::isPrecompressedVariantsEnabled() const
+{
+    Q_D(const QHttpServerStaticDirectory);
+    QMutexLocker locker(&d->mutex);
+    return d->precompressed;
+}
+
+/*!
+    Drops all files from the cache.
+*/
+void QHttpServerStaticDirectory::clearCache()
+{
+    Q_D(QHttpServerStaticDirectory);
+    QMutexLocker locker(&d->mutex);
+    d->cache.clear();
+}
+
+/*!
+    Returns the response to \a request for the file at \a path, relative to
+    rootPath().
+
+    \a path must already be percent-decoded. Paths with \c{..} segments and
+    files outside of rootPath(), for example through symbolic links, are
+    answered with QHttpServerResponder::StatusCode::NotFound.
+*/
+QHttpServerResponse QHttpServerStaticDirectory::response(const QHttpServerRequest &request,
+                                                         QStringView path) const
+{
+    Q_D(const QHttpServerStaticDirectory);
+
+    bool vary = false;
+    const auto entry = d->select(request, path, &vary);
+    if (!entry)
+        return QHttpServerResponse(QHttpServerResponse::StatusCode::NotFound);
+    return QHttpServerStaticDirectoryPrivate::responseFor(request, *entry, vary);
+}
+
+/*!
+    Answers \a request for the file at \a path, relative to rootPath(),
+    with \a responder.
+
+    Unlike response(), files that are too large to be cached are written to
+    \a responder as a QFile, so that their content is sent from the disk
+    without being copied, and range requests for them are answered with
+    QHttpServerResponder::StatusCode::PartialContent.
+
+    \a path must already be percent-decoded, as for response().
+
+    \code
+    server.route("/assets/<arg>", [&assets](const QUrl &path,
+                                            const QHttpServerRequest &request,
+                                            QHttpServerResponder &responder) {
+        assets.sendResponse(request, path.path(), responder);
+    });
+    \endcode
+
+    \sa setMaxCachedFileSize()
+*/
+void QHttpServerStaticDirectory::sendResponse(const QHttpServerRequest &request,
+                                              QStringView path,
+                                              QHttpServerResponder &responder) const
+{
+    Q_D(const QHttpServerStaticDirectory);
+
+    bool vary = false;
+    const auto entry = d->select(request, path, &vary);
+    if (!entry) {
+        responder.write(QHttpServerResponder::StatusCode::NotFound);
+        return;
+    }
+
+    QHttpHeaders headers;
+    if (QHttpServerStaticDirectoryPrivate::isNotModified(request, *entry)) {
+        QHttpServerStaticDirectoryPrivate::appendHeaders(headers, *entry, vary, false);
+        responder.write(headers, QHttpServerResponder::StatusCode::NotModified);
+        return;
+    }
+
+    QHttpServerStaticDirectoryPrivate::appendHeaders(headers, *entry, vary, true);
+    if (entry->filePath.isEmpty()) {
+        responder.write(entry->data, headers);
+        return;
+    }
+
+    auto file = std::make_unique<QFile>(entry->filePath);
+    if (!file->open(QFile::ReadOnly)) {
+        responder.write(QHttpServerResponder::StatusCode::NotFound);
+        return;
+    }
+    responder.write(file.release(), headers);
+}
+
+QT_END_NAMESPACE
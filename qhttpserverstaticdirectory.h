@@ -0,0 +1,50 @@
+// Copyright (C) 2025 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+// Qt-Security score:significant reason:default
+
+#pragma once
+
+#include <QtCore/qglobal.h>
+
+#include <QtCore/qstring.h>
+
+#include <memory>
+
+QT_BEGIN_NAMESPACE
+
+class QHttpServerRequest;
+class QHttpServerResponder;
+class QHttpServerResponse;
+
+class QHttpServerStaticDirectoryPrivate;
+class QHttpServerStaticDirectory final
+{
+    Q_DECLARE_PRIVATE(QHttpServerStaticDirectory)
+    Q_DISABLE_COPY_MOVE(QHttpServerStaticDirectory)
+
+public:
+    explicit QHttpServerStaticDirectory(const QString &rootPath);
+    ~QHttpServerStaticDirectory();
+
+    QString rootPath() const;
+
+    void setCacheSize(qsizetype bytes);
+    qsizetype cacheSize() const;
+
+    void setMaxCachedFileSize(qsizetype bytes);
+    qsizetype maxCachedFileSize() const;
+
+    void setPrecompressedVariantsEnabled(bool enabled);
+    bool isPrecompressedVariantsEnabled() const;
+
+    void clearCache();
+
+    QHttpServerResponse response(const QHttpServerRequest &request, QStringView path) const;
+    void sendResponse(const QHttpServerRequest &request, QStringView path,
+                      QHttpServerResponder &responder) const;
+
+private:
+    std::unique_ptr<QHttpServerStaticDirectoryPrivate> d_ptr;
+};
+
+QT_END_NAMESPACE
@@ -0,0 +1,89 @@
+// Copyright (C) 2025 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+// Qt-Security score:significant reason:default
+
+#pragma once
+
+#include "qhttpserverstaticdirectory.h"
+
+#include <QtCore/qbytearray.h>
+#include <QtCore/qcache.h>
+#include <QtCore/qdatetime.h>
+#include <QtCore/qfilesystemwatcher.h>
+#include <QtCore/qmutex.h>
+#include <QtCore/qset.h>
+
+#include <optional>
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists for the convenience
+// of QHttpServer. This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+
+QT_BEGIN_NAMESPACE
+
+class QFileInfo;
+class QHttpHeaders;
+
+class QHttpServerStaticDirectoryPrivate
+{
+public:
+    struct Entry
+    {
+        QByteArray data;
+        QByteArray mimeType;
+        QByteArray etag;
+        QByteArray lastModified;
+        QDateTime modified;
+        qint64 size = 0;
+        // Content coding of a precompressed variant
+        QByteArray encoding;
+        // Content codings of the precompressed variants of an identity entry
+        QList<QByteArray> encodings;
+        // Set if the content is too large to be cached and data is empty
+        QString filePath;
+    };
+
+    explicit QHttpServerStaticDirectoryPrivate(const QString &rootPath);
+
+    static QString cleanPath(QStringView path);
+    static QByteArray etagFor(const QDateTime &modified, qint64 size, QByteArrayView encoding);
+    static QByteArray httpDate(const QDateTime &dateTime);
+    static QByteArray negotiateEncoding(QByteArrayView acceptEncoding,
+                                        const QList<QByteArray> &encodings);
+    static bool isNotModified(const QHttpServerRequest &request, const Entry &entry);
+    static void appendHeaders(QHttpHeaders &headers, const Entry &entry, bool vary,
+                              bool withContent);
+    static void addHeaders(QHttpServerResponse &response, const Entry &entry, bool vary);
+    static QHttpServerResponse responseFor(const QHttpServerRequest &request, const Entry &entry,
+                                           bool vary);
+
+    QString filePath(const QString &relativePath) const { return root + u'/' + relativePath; }
+    bool isFileInRoot(const QFileInfo &info) const;
+    std::optional<Entry> find(const QString &key, const QByteArray &encoding,
+                              const QByteArray &mimeType) const;
+    std::optional<Entry> select(const QHttpServerRequest &request, QStringView path,
+                                bool *vary) const;
+    bool isCached(const QString &relativePath) const;
+    void watch(const QString &cacheKey, const QString &relativePath) const;
+    void invalidate(const QString &path);
+
+    const QString root;
+    qsizetype maxFileSize = 1024 * 1024;
+    bool precompressed = false;
+
+    // Guards cache, which is used from the threads handling requests
+    mutable QMutex mutex;
+    mutable QCache<QString, Entry> cache;
+
+    // Only used in the thread of watcher
+    mutable QFileSystemWatcher watcher;
+    mutable QSet<QString> watched;
+};
+
+QT_END_NAMESPACE
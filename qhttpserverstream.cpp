@@ -4,12 +4,18 @@
 
 #include "qhttpserverstream_p.h"
 
+#include "qhttpserverrequestfilter_p.h"
+
+#include <QtCore/qdatetime.h>
+#include <QtCore/qtimezone.h>
 #include <QtNetwork/qtcpsocket.h>
 
 #if QT_CONFIG(ssl)
 #include <QtNetwork/qsslsocket.h>
 #endif
 
+#include <cstdio>
+
 QT_BEGIN_NAMESPACE
 
 QHttpServerStream::QHttpServerStream(QObject *parent)
@@ -34,4 +40,69 @@ QHttpServerRequest QHttpServerStream::initRequestFromSocket(QTcpSocket *tcpSocke
     return QHttpServerRequest(QHostAddress::LocalHost, 0, QHostAddress::LocalHost, 0);
 }
 
+/*!
+    \internal
+
+    Writes \a body, which refers to memory that \a bodyOwner keeps alive.
+    The default implementation is for streams that are done with \a body
+    when write() returns.
+*/
+void QHttpServerStream::writeSharedBody(const QByteArray &body,
+                                        const std::shared_ptr<const void> &bodyOwner,
+                                        const QHttpHeaders &headers,
+                                        QHttpServerResponder::StatusCode status, quint32 streamId)
+{
+    Q_UNUSED(bodyOwner);
+    write(body, headers, status, streamId);
+}
+
+/*!
+    \internal
+
+    Returns the configuration of the server, which is copied from \a filter
+    only when it was changed since the last call.
+*/
+const QHttpServerConfiguration &QHttpServerStream::configuration(QHttpServerRequestFilter *filter)
+{
+    const quint32 generation = filter->configurationGeneration();
+    if (generation != m_configurationGeneration) {
+        m_configuration = filter->configuration();
+        m_configurationGeneration = generation;
+    }
+    return m_configuration;
+}
+
+/*!
+    \internal
+
+    Returns the current time as the value of a Date header, e.g.
+    "Sun, 06 Nov 1994 08:49:37 GMT". The value is formatted again only when
+    the second changes, and is valid until the next call in the same thread.
+*/
+QByteArrayView QHttpServerStream::httpDate()
+{
+    static constexpr qsizetype DateSize = 29;
+    struct Cache
+    {
+        qint64 second = -1;
+        char value[DateSize + 1] = {};
+    };
+    Q_CONSTINIT static thread_local Cache cache;
+
+    const qint64 now = QDateTime::currentSecsSinceEpoch();
+    if (now != cache.second) {
+        static constexpr char days[][4] = { "Mon", "Tue", "Wed", "Thu", "Fri", "Sat", "Sun" };
+        static constexpr char months[][4] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                              "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+        const QDateTime dateTime = QDateTime::fromSecsSinceEpoch(now, QTimeZone::UTC);
+        const QDate date = dateTime.date();
+        const QTime time = dateTime.time();
+        std::snprintf(cache.value, sizeof(cache.value), "%s, %02d %s %04d %02d:%02d:%02d GMT",
+                      days[date.dayOfWeek() - 1], date.day(), months[date.month() - 1],
+                      date.year(), time.hour(), time.minute(), time.second());
+        cache.second = now;
+    }
+    return QByteArrayView(cache.value, DateSize);
+}
+
 QT_END_NAMESPACE
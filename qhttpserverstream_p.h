@@ -7,9 +7,12 @@
 #include <QtCore/qobject.h>
 
 #include <QtCore/qglobal.h>
+#include "qhttpserverconfiguration.h"
 #include "qhttpserverresponder.h"
 #include "qhttpserverrequest.h"
 
+#include <memory>
+
 //
 //  W A R N I N G
 //  -------------
@@ -22,6 +25,7 @@
 
 QT_BEGIN_NAMESPACE
 
+class QHttpServerRequestFilter;
 class QTcpSocket;
 
 class QHttpServerStream : public QObject
@@ -33,12 +37,16 @@ class QHttpServerStream : public QObject
 protected:
     QHttpServerStream(QObject *parent = nullptr);
 
-    virtual void responderDestroyed() = 0;
+    virtual void responderDestroyed(quint32 streamId) = 0;
     virtual void startHandlingRequest() = 0;
     virtual void socketDisconnected() = 0;
 
     virtual void write(const QByteArray &body, const QHttpHeaders &headers,
                        QHttpServerResponder::StatusCode status, quint32 streamId) = 0;
+    virtual void writeSharedBody(const QByteArray &body,
+                                 const std::shared_ptr<const void> &bodyOwner,
+                                 const QHttpHeaders &headers,
+                                 QHttpServerResponder::StatusCode status, quint32 streamId);
     virtual void write(QHttpServerResponder::StatusCode status, quint32 streamId) = 0;
     virtual void write(QIODevice *data, const QHttpHeaders &headers,
                        QHttpServerResponder::StatusCode status, quint32 streamId) = 0;
@@ -52,6 +60,13 @@ protected:
                                  quint32 streamId) = 0;
 
     static QHttpServerRequest initRequestFromSocket(QTcpSocket *socket);
+
+    const QHttpServerConfiguration &configuration(QHttpServerRequestFilter *filter);
+    static QByteArrayView httpDate();
+
+private:
+    QHttpServerConfiguration m_configuration;
+    quint32 m_configurationGeneration = 0;
 };
 
 QT_END_NAMESPACE
@@ -0,0 +1,563 @@
+// Copyright (C) 2025 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+// Qt-Security score:critical reason:network-protocol
+
+#include "qhttpserverworkerpool_p.h"
+
+#include "qabstracthttpserver_p.h"
+#include "qhttpserverstream_p.h"
+
+#include <QtCore/qloggingcategory.h>
+#include <QtCore/qthread.h>
+#include <QtNetwork/qtcpserver.h>
+#include <QtNetwork/qtcpsocket.h>
+
+#if QT_CONFIG(ssl)
+#include <QtCore/qtimer.h>
+#include <QtNetwork/qsslserver.h>
+#include <QtNetwork/qsslsocket.h>
+#endif
+
+#include <algorithm>
+
+#if defined(Q_OS_UNIX)
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#endif
+
+QT_BEGIN_NAMESPACE
+
+Q_STATIC_LOGGING_CATEGORY(lcHttpServerWorker, "qt.httpserver.worker")
+
+namespace {
+
+#if defined(Q_OS_UNIX)
+void closeDescriptor(int fd)
+{
+    int ret;
+    do {
+        ret = ::close(fd);
+    } while (ret == -1 && errno == EINTR);
+}
+#endif
+
+#if defined(Q_OS_UNIX) && defined(SO_REUSEPORT)
+
+// Same as the default of QTcpServer::listenBacklogSize()
+constexpr int ListenBacklog = 50;
+
+/*
+    Creates a non-blocking socket listening on \a address and \a port that
+    shares the port with the other sockets created by this function, so that
+    the kernel spreads the incoming connections over all of them.
+*/
+int createReusePortSocket(const QHostAddress &address, quint16 port)
+{
+    sockaddr_storage storage = {};
+    socklen_t length = 0;
+    bool dualStack = false;
+
+    if (address == QHostAddress::Any || address.protocol() == QAbstractSocket::IPv6Protocol) {
+        auto *sa = reinterpret_cast<sockaddr_in6 *>(&storage);
+        sa->sin6_family = AF_INET6;
+        sa->sin6_port = htons(port);
+        const Q_IPV6ADDR ip = address == QHostAddress::Any
+                ? QHostAddress(QHostAddress::AnyIPv6).toIPv6Address()
+                : address.toIPv6Address();
+        memcpy(&sa->sin6_addr, &ip, sizeof(ip));
+        length = sizeof(sockaddr_in6);
+        dualStack = address == QHostAddress::Any;
+    } else if (address.protocol() == QAbstractSocket::IPv4Protocol) {
+        auto *sa = reinterpret_cast<sockaddr_in *>(&storage);
+        sa->sin_family = AF_INET;
+        sa->sin_port = htons(port);
+        sa->sin_addr.s_addr = htonl(address.toIPv4Address());
+        length = sizeof(sockaddr_in);
+    } else {
+        qCWarning(lcHttpServerWorker) << "Unsupported address" << address;
+        return -1;
+    }
+
+    int fd = ::socket(storage.ss_family, SOCK_STREAM, 0);
+    if (fd == -1 && dualStack && errno == EAFNOSUPPORT) {
+        // No IPv6 on this host, fall back to IPv4 only
+        return createReusePortSocket(QHostAddress::AnyIPv4, port);
+    }
+    if (fd == -1) {
+        qCWarning(lcHttpServerWorker, "Could not create socket: %s", strerror(errno));
+        return -1;
+    }
+
+    const int on = 1;
+    const int v6Only = dualStack ? 0 : 1;
+    const bool ok = ::fcntl(fd, F_SETFD, FD_CLOEXEC) != -1
+            && ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK) != -1
+            && ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) == 0
+            && ::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) == 0
+            && (storage.ss_family != AF_INET6
+                || ::setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &v6Only, sizeof(v6Only)) == 0)
+            && ::bind(fd, reinterpret_cast<sockaddr *>(&storage), length) == 0
+            && ::listen(fd, ListenBacklog) == 0;
+    if (!ok) {
+        qCWarning(lcHttpServerWorker, "Could not listen on %ls:%u: %s",
+                  qUtf16Printable(address.toString()), port, strerror(errno));
+        closeDescriptor(fd);
+        return -1;
+    }
+    return fd;
+}
+
+quint16 boundPort(int fd)
+{
+    sockaddr_storage storage = {};
+    socklen_t length = sizeof(storage);
+    if (::getsockname(fd, reinterpret_cast<sockaddr *>(&storage), &length) != 0)
+        return 0;
+    if (storage.ss_family == AF_INET6)
+        return ntohs(reinterpret_cast<const sockaddr_in6 *>(&storage)->sin6_port);
+    return ntohs(reinterpret_cast<const sockaddr_in *>(&storage)->sin_port);
+}
+
+#endif // Q_OS_UNIX && SO_REUSEPORT
+
+} // anonymous namespace
+
+/*!
+    \internal
+    \class QHttpServerWorker
+
+    Lives in a thread of a QHttpServerWorkerPool and owns the listening
+    sockets and protocol handlers of that thread, whether the connections
+    were accepted by the worker itself or handed to it.
+*/
+QHttpServerWorker::QHttpServerWorker(QAbstractHttpServerPrivate *server)
+    : server(server)
+{
+}
+
+/*!
+    \internal
+
+    Starts accepting connections on the listening socket \a socketDescriptor.
+    Must be called in the thread of the worker.
+*/
+bool QHttpServerWorker::listen(qintptr socketDescriptor)
+{
+    Q_ASSERT(QThread::currentThread() == thread());
+    auto *tcpServer = new QTcpServer(this);
+    if (!tcpServer->setSocketDescriptor(socketDescriptor)) {
+        qCWarning(lcHttpServerWorker) << "Could not use listening socket:"
+                                      << tcpServer->errorString();
+        delete tcpServer;
+        return false;
+    }
+    connect(tcpServer, &QTcpServer::pendingConnectionAvailable,
+            this, &QHttpServerWorker::handleNewConnections);
+    return true;
+}
+
+/*!
+    \internal
+
+    Stops accepting connections on the listening socket \a socketDescriptor
+    and closes it. Must be called in the thread of the worker.
+*/
+void QHttpServerWorker::stopListening(qintptr socketDescriptor)
+{
+    Q_ASSERT(QThread::currentThread() == thread());
+    const auto tcpServers = findChildren<QTcpServer *>(Qt::FindDirectChildrenOnly);
+    for (QTcpServer *tcpServer : tcpServers) {
+        if (tcpServer->socketDescriptor() == socketDescriptor) {
+            tcpServer->close();
+            delete tcpServer;
+            return;
+        }
+    }
+}
+
+/*!
+    \internal
+*/
+void QHttpServerWorker::handleNewConnections()
+{
+    auto tcpServer = qobject_cast<QTcpServer *>(sender());
+    Q_ASSERT(tcpServer);
+
+    while (auto socket = tcpServer->nextPendingConnection()) {
+        ++connectionCount;
+        handleConnection(socket);
+    }
+}
+
+/*!
+    \internal
+
+    Creates the protocol handler for \a socket, which must already live in
+    the thread of this worker and be counted in connectionCount.
+*/
+void QHttpServerWorker::handleConnection(QIODevice *socket)
+{
+    Q_ASSERT(QThread::currentThread() == thread());
+    QHttpServerStream *handler = server->createProtocolHandler(socket, this);
+    connect(handler, &QObject::destroyed, this, [this] { --connectionCount; });
+}
+
+#if QT_CONFIG(ssl)
+/*!
+    \internal
+
+    Encrypts the connection accepted on \a socketDescriptor with
+    \a configuration and creates its protocol handler once the TLS handshake
+    is done, so that the handshake runs in the thread of the worker. The
+    connection is closed if the handshake fails or does not finish within
+    \a handshakeTimeout milliseconds. The connection must already be counted
+    in connectionCount.
+*/
+void QHttpServerWorker::startServerEncryption(qintptr socketDescriptor,
+                                              const QSslConfiguration &configuration,
+                                              int handshakeTimeout)
+{
+    Q_ASSERT(QThread::currentThread() == thread());
+    auto *socket = new QSslSocket(this);
+    socket->setSslConfiguration(configuration);
+    if (!socket->setSocketDescriptor(socketDescriptor)) {
+        qCWarning(lcHttpServerWorker) << "Could not use accepted socket:"
+                                      << socket->errorString();
+        delete socket;
+#if defined(Q_OS_UNIX)
+        closeDescriptor(int(socketDescriptor));
+#endif
+        --connectionCount;
+        return;
+    }
+
+    auto *timer = new QTimer(socket);
+    timer->setSingleShot(true);
+
+    const auto abortHandshake = [this, socket, timer] {
+        qCDebug(lcHttpServerWorker) << "TLS handshake failed:" << socket->errorString();
+        socket->disconnect(this);
+        timer->disconnect(this);
+        socket->abort();
+        socket->deleteLater();
+        --connectionCount;
+    };
+    connect(socket, &QAbstractSocket::errorOccurred, this, abortHandshake);
+    connect(socket, &QAbstractSocket::disconnected, this, abortHandshake);
+    connect(timer, &QTimer::timeout, this, abortHandshake);
+    connect(socket, &QSslSocket::encrypted, this, [this, socket, timer] {
+        socket->disconnect(this);
+        delete timer;
+        handleConnection(socket);
+    });
+
+    timer->start(handshakeTimeout);
+    socket->startServerEncryption();
+}
+#endif
+
+/*!
+    \internal
+    \class QHttpServerWorkerPool
+
+    Runs a number of worker threads, each of them with its own event loop,
+    listening sockets and protocol handlers. Connections accepted in the
+    thread of the server can be handed off to the least loaded worker.
+*/
+QHttpServerWorkerPool::QHttpServerWorkerPool(QAbstractHttpServerPrivate *server)
+    : server(server)
+{
+}
+
+QHttpServerWorkerPool::~QHttpServerWorkerPool()
+{
+    stop();
+}
+
+/*!
+    \internal
+
+    Sets the number of worker threads to \a count. A \a count of 0 means
+    QThread::idealThreadCount(). Running workers are stopped if the number
+    changes.
+*/
+void QHttpServerWorkerPool::setThreadCount(int count)
+{
+    count = qMax(count, 0);
+    if (count == requestedThreadCount)
+        return;
+    stop();
+    requestedThreadCount = count;
+}
+
+/*!
+    \internal
+*/
+int QHttpServerWorkerPool::threadCount() const
+{
+    return requestedThreadCount > 0 ? requestedThreadCount : QThread::idealThreadCount();
+}
+
+/*!
+    \internal
+*/
+void QHttpServerWorkerPool::start()
+{
+    Q_ASSERT(workers.empty());
+    const int count = threadCount();
+    workers.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        Worker w{ std::make_unique<QThread>(), new QHttpServerWorker(server) };
+        w.thread->setObjectName(QStringLiteral("QHttpServer worker %1").arg(i));
+        w.worker->moveToThread(w.thread.get());
+        QObject::connect(w.thread.get(), &QThread::finished, w.worker, &QObject::deleteLater);
+        w.thread->start();
+        workers.push_back(std::move(w));
+    }
+}
+
+/*!
+    \internal
+
+    Stops all worker threads. The protocol handlers of the workers are
+    destroyed, which closes their connections.
+*/
+void QHttpServerWorkerPool::stop()
+{
+    for (auto &w : workers)
+        w.thread->quit();
+    for (auto &w : workers)
+        w.thread->wait();
+    workers.clear();
+    ports.clear();
+}
+
+/*!
+    \internal
+
+    Makes every worker thread listen on its own socket bound to \a address
+    and \a port with \c SO_REUSEPORT. If \a port is 0, a port is chosen
+    automatically and shared by all workers.
+*/
+bool QHttpServerWorkerPool::listen(const QHostAddress &address, quint16 port)
+{
+#if defined(Q_OS_UNIX) && defined(SO_REUSEPORT)
+    if (workers.empty())
+        start();
+
+    std::vector<int> descriptors;
+    descriptors.reserve(workers.size());
+    for (size_t i = 0; i < workers.size(); ++i) {
+        const int fd = createReusePortSocket(address, port);
+        if (fd == -1) {
+            for (int d : descriptors)
+                closeDescriptor(d);
+            return false;
+        }
+        if (port == 0)
+            port = boundPort(fd);
+        descriptors.push_back(fd);
+    }
+
+    for (size_t i = 0; i < workers.size(); ++i) {
+        QHttpServerWorker *worker = workers[i].worker;
+        const int fd = descriptors[i];
+        bool ok = false;
+        QMetaObject::invokeMethod(worker, [worker, fd, &ok] {
+            ok = worker->listen(fd);
+        }, Qt::BlockingQueuedConnection);
+        if (ok)
+            continue;
+
+        // Do not leave some of the workers listening
+        for (size_t j = 0; j < i; ++j) {
+            QHttpServerWorker *listening = workers[j].worker;
+            const int listeningFd = descriptors[j];
+            QMetaObject::invokeMethod(listening, [listening, listeningFd] {
+                listening->stopListening(listeningFd);
+            }, Qt::BlockingQueuedConnection);
+        }
+        for (size_t j = i; j < descriptors.size(); ++j)
+            closeDescriptor(descriptors[j]);
+        return false;
+    }
+
+    ports.append(port);
+    return true;
+#else
+    Q_UNUSED(address);
+    Q_UNUSED(port);
+    qCWarning(lcHttpServerWorker, "SO_REUSEPORT is not supported on this platform");
+    return false;
+#endif
+}
+
+/*!
+    \internal
+
+    Returns the worker with the fewest connections. The workers are started
+    if they are not running yet.
+*/
+QHttpServerWorker *QHttpServerWorkerPool::leastLoadedWorker()
+{
+    if (workers.empty())
+        start();
+
+    const auto it = std::min_element(workers.cbegin(), workers.cend(),
+                                     [](const Worker &lhs, const Worker &rhs) {
+        return lhs.worker->connectionCount.load(std::memory_order_relaxed)
+                < rhs.worker->connectionCount.load(std::memory_order_relaxed);
+    });
+    return it->worker;
+}
+
+/*!
+    \internal
+
+    Moves the accepted \a socket to the worker with the fewest connections,
+    which then creates the protocol handler for it.
+*/
+void QHttpServerWorkerPool::handOff(QIODevice *socket)
+{
+    QHttpServerWorker *worker = leastLoadedWorker();
+
+    socket->setParent(nullptr);
+    socket->moveToThread(worker->thread());
+    ++worker->connectionCount;
+    QMetaObject::invokeMethod(worker, [worker, socket] {
+        worker->handleConnection(socket);
+    }, Qt::QueuedConnection);
+}
+
+#if QT_CONFIG(ssl)
+/*!
+    \internal
+
+    Hands the connection accepted on \a socketDescriptor to the worker with
+    the fewest connections before it is encrypted. The worker runs the TLS
+    handshake with \a configuration and \a handshakeTimeout, and then creates
+    the protocol handler.
+*/
+void QHttpServerWorkerPool::handOffEncrypted(qintptr socketDescriptor,
+                                             const QSslConfiguration &configuration,
+                                             int handshakeTimeout)
+{
+    QHttpServerWorker *worker = leastLoadedWorker();
+
+    ++worker->connectionCount;
+    QMetaObject::invokeMethod(worker, [worker, socketDescriptor, configuration,
+                                       handshakeTimeout] {
+        worker->startServerEncryption(socketDescriptor, configuration, handshakeTimeout);
+    }, Qt::QueuedConnection);
+}
+#endif
+
+/*!
+    \internal
+
+    Returns the number of connections of every running worker.
+*/
+QList<int> QHttpServerWorkerPool::connectionCounts() const
+{
+    QList<int> counts;
+    counts.reserve(qsizetype(workers.size()));
+    for (const auto &w : workers)
+        counts.append(w.worker->connectionCount.load(std::memory_order_relaxed));
+    return counts;
+}
+
+#if QT_CONFIG(ssl)
+/*!
+    \internal
+    \class QHttpServerTlsAcceptor
+
+    Accepts the connections of a QSslServer in its place while connections
+    are handed off, and passes them to the worker pool unencrypted, so that
+    the TLS handshake does not run in the thread of the QSslServer.
+*/
+QHttpServerTlsAcceptor::QHttpServerTlsAcceptor(QSslServer *sslServer,
+                                               QHttpServerWorkerPool *pool)
+    : QTcpServer(sslServer), sslServer(sslServer), pool(pool)
+{
+}
+
+/*!
+    \internal
+
+    Pauses accepting on \a sslServer and accepts its connections with an
+    acceptor that hands them off to \a pool instead. Returns \c false if
+    this is not supported on the platform.
+*/
+bool QHttpServerTlsAcceptor::takeOver(QSslServer *sslServer, QHttpServerWorkerPool *pool)
+{
+    if (sslServer->findChild<QHttpServerTlsAcceptor *>(Qt::FindDirectChildrenOnly))
+        return true;
+
+#if defined(Q_OS_UNIX)
+    // Listen on a duplicate of the descriptor, so that closing either server
+    // does not close the socket of the other one.
+    const int fd = ::fcntl(int(sslServer->socketDescriptor()), F_DUPFD_CLOEXEC, 0);
+    if (fd == -1) {
+        qCWarning(lcHttpServerWorker, "Could not duplicate listening socket: %s",
+                  strerror(errno));
+        return false;
+    }
+
+    auto *acceptor = new QHttpServerTlsAcceptor(sslServer, pool);
+    if (!acceptor->setSocketDescriptor(fd)) {
+        qCWarning(lcHttpServerWorker) << "Could not use listening socket:"
+                                      << acceptor->errorString();
+        delete acceptor;
+        closeDescriptor(fd);
+        return false;
+    }
+    sslServer->pauseAccepting();
+    return true;
+#else
+    Q_UNUSED(pool);
+    return false;
+#endif
+}
+
+/*!
+    \internal
+
+    Stops the acceptor of \a sslServer, if any, and lets \a sslServer accept
+    its connections again.
+*/
+void QHttpServerTlsAcceptor::release(QSslServer *sslServer)
+{
+    auto *acceptor = sslServer->findChild<QHttpServerTlsAcceptor *>(Qt::FindDirectChildrenOnly);
+    if (!acceptor)
+        return;
+    delete acceptor;
+    if (sslServer->isListening())
+        sslServer->resumeAccepting();
+}
+
+/*!
+    \internal
+*/
+void QHttpServerTlsAcceptor::incomingConnection(qintptr socketDescriptor)
+{
+    if (!sslServer->isListening()) {
+        // The QSslServer was closed, stop accepting on its behalf
+#if defined(Q_OS_UNIX)
+        closeDescriptor(int(socketDescriptor));
+#endif
+        close();
+        deleteLater();
+        return;
+    }
+    pool->handOffEncrypted(socketDescriptor, sslServer->sslConfiguration(),
+                           sslServer->handshakeTimeout());
+}
+#endif
+
+QT_END_NAMESPACE
@@ -0,0 +1,126 @@
+// Copyright (C) 2025 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+// Qt-Security score:significant reason:default
+
+#pragma once
+
+#include <QtCore/qglobal.h>
+#include <QtCore/qlist.h>
+#include <QtCore/qobject.h>
+#include <QtNetwork/qhostaddress.h>
+#include <QtNetwork/qtcpserver.h>
+
+#if QT_CONFIG(ssl)
+#include <QtNetwork/qsslconfiguration.h>
+#endif
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists for the convenience
+// of QHttpServer. This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+
+QT_BEGIN_NAMESPACE
+
+class QAbstractHttpServerPrivate;
+class QHttpServerWorkerPool;
+class QIODevice;
+class QSslServer;
+class QThread;
+
+class QHttpServerWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit QHttpServerWorker(QAbstractHttpServerPrivate *server);
+
+    bool listen(qintptr socketDescriptor);
+    void stopListening(qintptr socketDescriptor);
+    void handleConnection(QIODevice *socket);
+#if QT_CONFIG(ssl)
+    void startServerEncryption(qintptr socketDescriptor, const QSslConfiguration &configuration,
+                               int handshakeTimeout);
+#endif
+
+    // Connections handled by this worker, including the ones handed to it
+    // that it did not pick up yet.
+    std::atomic<int> connectionCount = 0;
+
+private:
+    void handleNewConnections();
+
+    QAbstractHttpServerPrivate *server;
+};
+
+class QHttpServerWorkerPool
+{
+    Q_DISABLE_COPY_MOVE(QHttpServerWorkerPool)
+
+public:
+    explicit QHttpServerWorkerPool(QAbstractHttpServerPrivate *server);
+    ~QHttpServerWorkerPool();
+
+    void setThreadCount(int count);
+    int threadCount() const;
+
+    bool listen(const QHostAddress &address, quint16 port);
+    QList<quint16> serverPorts() const { return ports; }
+    bool isRunning() const { return !workers.empty(); }
+    void stop();
+
+    void setHandOffEnabled(bool enabled) { handOffEnabled = enabled; }
+    bool isHandOffEnabled() const { return handOffEnabled; }
+    void handOff(QIODevice *socket);
+#if QT_CONFIG(ssl)
+    void handOffEncrypted(qintptr socketDescriptor, const QSslConfiguration &configuration,
+                          int handshakeTimeout);
+#endif
+    QList<int> connectionCounts() const;
+
+private:
+    void start();
+    QHttpServerWorker *leastLoadedWorker();
+
+    struct Worker
+    {
+        std::unique_ptr<QThread> thread;
+        QHttpServerWorker *worker;
+    };
+
+    QAbstractHttpServerPrivate *server;
+    int requestedThreadCount = 0;
+    bool handOffEnabled = false;
+    std::vector<Worker> workers;
+    QList<quint16> ports;
+};
+
+#if QT_CONFIG(ssl)
+class QHttpServerTlsAcceptor : public QTcpServer
+{
+    Q_OBJECT
+
+public:
+    static bool takeOver(QSslServer *sslServer, QHttpServerWorkerPool *pool);
+    static void release(QSslServer *sslServer);
+
+protected:
+    void incomingConnection(qintptr socketDescriptor) override;
+
+private:
+    QHttpServerTlsAcceptor(QSslServer *sslServer, QHttpServerWorkerPool *pool);
+
+    QSslServer *sslServer;
+    QHttpServerWorkerPool *pool;
+};
+#endif
+
+QT_END_NAMESPACE